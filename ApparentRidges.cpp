@@ -11,9 +11,12 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include "LoadShader.h"
 #include "Model.h"
+#include "ModelResidency.h"
+#include "FrameUniforms.h"
 // settings
 const unsigned int SCR_WIDTH = 2400;
 const unsigned int SCR_HEIGHT = 1350;
@@ -37,6 +40,24 @@ bool PDsOn = false;
 bool drawFaded = true;
 bool apparentCullFaces = false;
 bool transparent = false;
+//false : extract the ridges per triangle in the geometry shader (apparentRidges.gs) instead of apparentRidges.compute
+bool computeRidgeExtraction = true;
+
+// Model residency
+//false : start loading every model at startup (uploaded as they finish, as long as they fit the budget)
+bool loadModelsOnDemand = true;
+const size_t modelVRAMBudget = size_t(1) << 30;
+const size_t modelHostBudget = size_t(2) << 30;
+//true : time the native OBJ loader against Assimp for every .obj in modelPaths at startup
+bool benchmarkObjParser = false;
+//true : time the per frame view dependent passes with first use against Morton vertex order for every model at startup
+bool benchmarkSpaceFillingOrder = false;
+//true : time the per face curvature kernel on every instruction set the CPU supports for every model at startup
+bool benchmarkCurvatureSIMD = false;
+//true : time every CPU curvature stage in float against double and compare their results for every model at startup
+bool benchmarkCurvatureDouble = false;
+//true : compare curvatures updated after a vertex edit (Model::updateCurvatures()) with a full recompute for every model at startup
+bool checkCurvatureUpdates = false;
 int main()
 {
     float lineWidth = 2.5;
@@ -98,30 +119,51 @@ int main()
     ImGui_ImplOpenGL3_Init("#version 430");
 
     //Load Models
-    std::vector<Model> models;
     //order causes no bugs
-    //models.push_back(Model(".\\models\\cow.obj"));
-    //models.push_back(Model(".\\models\\Zagato.obj"));
-    models.push_back(Model(".\\models\\stanford-bunny.obj"));
-    models.push_back(Model(".\\models\\max-planck.obj"));
-
-    //models.push_back(Model(".\\models\\Victory.obj"));
-    //models.push_back(Model(".\\models\\lucy.obj"));
-    //models.push_back(Model(".\\models\\rapid.obj"));
-    //models.push_back(Model(".\\models\\brain.obj"));
-    //models.push_back(Model(".\\models\\Nefertiti.obj"));
-    /*
-    models.push_back(Model(".\\models\\column.obj"));
-    //models.push_back(Model(".\\models\\xyzrgb_dragon.obj"));
-    */
-    //"Bunny", "Planck","Lucy", "David", "Brain",/*"Dragon",*/ "Nefertiti"};
+    std::vector<std::string> modelPaths = {
+        //".\\models\\cow.obj",
+        //".\\models\\Zagato.obj",
+        ".\\models\\stanford-bunny.obj",
+        ".\\models\\max-planck.obj",
+        //".\\models\\Victory.obj",
+        //".\\models\\lucy.obj",
+        //".\\models\\rapid.obj",
+        //".\\models\\brain.obj",
+        //".\\models\\Nefertiti.obj",
+        //".\\models\\column.obj",
+        //".\\models\\xyzrgb_dragon.obj",
+        //".\\models\\maxplanck.ply",
+        //".\\models\\bunny2.ply",
+    };
+    if (benchmarkObjParser) {
+        for (const std::string& path : modelPaths)
+            if (fileExtension(path) == "obj") benchmarkObjLoader(path);
+    }
+    if (benchmarkCurvatureSIMD) {
+        for (const std::string& path : modelPaths) benchmarkCurvatureKernels(path);
+    }
+    if (benchmarkCurvatureDouble) {
+        for (const std::string& path : modelPaths) benchmarkCurvaturePrecision(path);
+    }
+    if (benchmarkSpaceFillingOrder) {
+        for (const std::string& path : modelPaths) benchmarkVertexOrder(path);
+    }
+    if (checkCurvatureUpdates) {
+        for (const std::string& path : modelPaths) checkCurvatureUpdate(path);
+    }
+    //Parsing / cache mapping runs on the thread pool, GL upload and the load time compute passes on this thread.
+    //Models are loaded the first time they're selected and evicted from the GPU when over budget.
+    ModelResidency models(modelPaths, modelVRAMBudget, modelHostBudget);
+    if (!loadModelsOnDemand) models.prefetchAll();
 
-    Model* currentModel = &models[0];
+    Model* currentModel = nullptr;
 
     //Load Shaders
     GLuint diffuse = loadShader(".\\shaders\\diffuse.vs", ".\\shaders\\diffuse.fs");
     GLuint base = loadShader(".\\shaders\\base.vs", ".\\shaders\\base.fs");
     GLuint apparentRidges = loadShader(".\\shaders\\apparentRidges.vs", ".\\shaders\\apparentRidges.fs",".\\shaders\\apparentRidges.gs");
+    //draws the segments Model::extractRidges() appended
+    GLuint ridgeLines = loadShader(".\\shaders\\ridgeLines.vs", ".\\shaders\\apparentRidges.fs");
     //GLuint apparentRidges = diffuse;
     GLuint maxPDShader = loadShader(".\\shaders\\PDmax.vs",".\\shaders\\PDmax.fs",".\\shaders\\PDmax.gs");
     GLuint minPDShader = loadShader(".\\shaders\\PDmin.vs",".\\shaders\\PDmin.fs",".\\shaders\\PDmin.gs");
@@ -158,6 +200,10 @@ int main()
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         glLineWidth(lineWidth);
+
+        //Uploads at most one prefetched model per frame so the window keeps drawing while the rest load.
+        models.update();
+
         //IMGui new frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -170,10 +216,16 @@ int main()
         ImGui::Checkbox("Draw Faded Lines", &drawFaded);
         ImGui::Checkbox("Cull Apparent Ridges", &apparentCullFaces);
         ImGui::Checkbox("Transparent", &transparent);
-        const char* listboxItems[] = { "Bunny", "Planck","Lucy", "David", "Brain",/*"Dragon",*/ "Nefertiti"};
+        bool exportRidges = ImGui::Button("Export Apparent Ridges");
+        bool bumpSurface = ImGui::Button("Bump Surface");
+        std::vector<const char*> listboxItems;
+        for (size_t i = 0; i < models.count(); i++) listboxItems.push_back(models.name(i).c_str());
         static int currentlistboxItem = 0;
-        ImGui::ListBox("Model", &currentlistboxItem, listboxItems, IM_ARRAYSIZE(listboxItems), 3);
-        currentModel = &models[currentlistboxItem];
+        ImGui::ListBox("Model", &currentlistboxItem, listboxItems.data(), int(listboxItems.size()), 3);
+        currentModel = models.count() ? models.acquire(currentlistboxItem) : nullptr;
+        if (models.count() && models.failed(currentlistboxItem)) ImGui::Text("Failed to load %s", listboxItems[currentlistboxItem]);
+        else if (currentModel == nullptr) ImGui::Text("Loading %s...", models.count() ? listboxItems[currentlistboxItem] : "");
+        ImGui::Text("Resident : %.1f / %.1f MB VRAM", models.residentBytes() / 1048576.0, modelVRAMBudget / 1048576.0);
 
         ImGui::SliderFloat("Rotate X", &xDegrees, 0.0f, 360.0f);
         ImGui::SliderFloat("Rotate Y", &yDegrees, 0.0f, 360.0f);
@@ -188,6 +240,21 @@ int main()
         //ImGui::SliderFloat("Brightness", &diffuse, 0.0f, 2.0f);
         ImGui::End();
 
+        //Nothing to draw until the selected model is resident
+        if (currentModel == nullptr) {
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+            continue;
+        }
+
+        //edits a patch around a different vertex every click, curvatures are only updated around it
+        if (bumpSurface && currentModel->numVertices) {
+            static uint32_t bumps = 0;
+            const uint32_t center = uint32_t((++bumps * 2654435761ull) % currentModel->numVertices);
+            currentModel->bumpVertices(center, 0.05f * currentModel->diagonalLength, 0.01f * currentModel->diagonalLength);
+        }
 
         if (ridgesOn) { currentShader = &apparentRidges; currentModel->apparentRidges = true; }
         else { currentShader = &diffuse; currentModel->apparentRidges = false;}
@@ -198,9 +265,6 @@ int main()
         glm::mat4 lightRotate = glm::rotate(glm::mat4(1), glm::radians(lightDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
         lightPos = glm::vec3(lightRotate * glm::vec4(lightPosInit, 0.0f));
 
-        glUniform3f(glGetUniformLocation(*currentShader, "light.position"), lightPos.x, lightPos.y, lightPos.z);
-        //glUniform3f(glGetUniformLocation(*currentShader, "light.diffuse"), lightDiffuse.x, lightDiffuse.y, lightDiffuse.z);
-        
         //opengl matrice transforms are applied from the right side. (last first)
         glm::mat4 model = glm::mat4(1);
         model = glm::translate(model, glm::vec3(0.0f, 0.0f, -1.0f));
@@ -214,11 +278,36 @@ int main()
         glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 
         currentModel->modelMatrix = model;
+        currentModel->viewPosition = cameraPos;
+
+        //Written once for every program and compute pass of the frame, then once per model drawn (FrameUniforms.h)
+        FrameConstants frame = {};
+        frame.view = view;
+        frame.projection = projection;
+        frame.viewPosition = glm::vec4(cameraPos, 1.0f);
+        frame.lightPosition = glm::vec4(lightPos, 1.0f);
+        frame.lineColor = glm::vec4(lineColor, 1.0f);
+        frame.backgroundColor = glm::vec4(background, 1.0f);
+        frame.drawFaded = drawFaded;
+        frame.cull = apparentCullFaces;
+        frameUniforms().begin(frame);
+        DrawConstants draw = {};
+        draw.model = model;
+        //the view dependent passes and the ridge shaders work in object space
+        draw.objectViewPosition = glm::vec4(currentModel->objectViewPosition(), 1.0f);
+        //threshold is scaled to the reciprocal of feature size
+        //if (currentModel->minDistance>1.0f)
+            //draw.threshold = 0.2f*thresholdScale/(currentModel->minDistance);
+            draw.threshold = 0.02f * thresholdScale / (currentModel->minDistance * currentModel->minDistance);
+        //else
+          //  draw.threshold = 3.0f * thresholdScale * currentModel->minDistance;
+        currentModel->ridgeThreshold = draw.threshold;
+        draw.PDMagnitude = 0.02f * PDLengthScale * currentModel->modelScaleFactor * modelSize;
+        frameUniforms().draw(draw);
+        //clusters outside the view, or facing away when culling, skip the view dependent passes
+        currentModel->viewProjection = projection * view;
+        currentModel->cullBackFacing = apparentCullFaces;
 
-        glUniformMatrix4fv(glGetUniformLocation(*currentShader, "model"), 1, GL_FALSE, &model[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(*currentShader, "view"), 1, GL_FALSE, &view[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(*currentShader, "projection"), 1, GL_FALSE, &projection[0][0]);
-        glUniform3f(glGetUniformLocation(*currentShader, "viewPosition"), cameraPos.x, cameraPos.y, cameraPos.z);
         if (ridgesOn) {
             glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             //No guarantee this does anything.
@@ -229,36 +318,16 @@ int main()
             if (!transparent) {
             //render base model
             glUseProgram(base);
-            glUniformMatrix4fv(glGetUniformLocation(base, "model"), 1, GL_FALSE, &model[0][0]);
-            glUniformMatrix4fv(glGetUniformLocation(base, "view"), 1, GL_FALSE, &view[0][0]);
-            glUniformMatrix4fv(glGetUniformLocation(base, "projection"), 1, GL_FALSE, &projection[0][0]);
-            glUniform3f(glGetUniformLocation(base, "backgroundColor"), background.x, background.y, background.z);
             currentModel->render(base);
             }
 
             //render apparent ridges
             currentModel->apparentRidges = true;
-            glUseProgram(currentModel->viewDepCurvatureCompute);
-            glUniform3f(glGetUniformLocation(currentModel->viewDepCurvatureCompute, "viewPosition"), cameraPos.x, cameraPos.y, cameraPos.z);
-            //glUniformMatrix4fv(glGetUniformLocation(currentModel->viewDepCurvatureCompute, "model"), 1, GL_FALSE, &model[0][0]);
-            
-            glUseProgram(currentModel->Dt1q1Compute);
-            glUniform3f(glGetUniformLocation(currentModel->Dt1q1Compute, "viewPosition"), cameraPos.x, cameraPos.y, cameraPos.z);
-            //glUniformMatrix4fv(glGetUniformLocation(currentModel->Dt1q1Compute, "model"), 1, GL_FALSE, &model[0][0]);
-            
             glUseProgram(apparentRidges);
-            //threshold is scaled to the reciprocal of feature size
-            
-            //if (currentModel->minDistance>1.0f)
-                //glUniform1f(glGetUniformLocation(apparentRidges,"threshold"),0.2f*thresholdScale/(currentModel->minDistance));
-                glUniform1f(glGetUniformLocation(apparentRidges, "threshold"), 0.02f * thresholdScale / (currentModel->minDistance * currentModel->minDistance));
-            //else
-              //  glUniform1f(glGetUniformLocation(apparentRidges, "threshold"), 3.0f * thresholdScale * currentModel->minDistance);
-
-            glUniform3f(glGetUniformLocation(apparentRidges,"lineColor"), lineColor.x,lineColor.y,lineColor.z);
-            glUniform3f(glGetUniformLocation(apparentRidges, "backgroundColor"), background.x, background.y, background.z);
-            glUniform1i(glGetUniformLocation(apparentRidges, "drawFaded"), drawFaded);
-            glUniform1i(glGetUniformLocation(apparentRidges, "cull"), apparentCullFaces);
+            if (computeRidgeExtraction) {
+                currentModel->extractRidges();
+                if (exportRidges) currentModel->exportRidges(currentModel->path + ".ridges.obj");
+            }
 
             currentModel->apparentRidges = false;
         }
@@ -268,27 +337,20 @@ int main()
         glDisable(GL_POLYGON_SMOOTH);
         if (PDsOn) {
             //Render Principal Directions
+            //size has an explicit location, everything else is in the frame constants
             glUseProgram(maxPDShader);
-            glUniform1f(glGetUniformLocation(maxPDShader, "magnitude"), 0.02f* PDLengthScale * currentModel->modelScaleFactor * modelSize);
-            glUniformMatrix4fv(glGetUniformLocation(maxPDShader, "model"), 1, GL_FALSE, &model[0][0]);
-            glUniformMatrix4fv(glGetUniformLocation(maxPDShader, "view"), 1, GL_FALSE, &view[0][0]);
-            glUniformMatrix4fv(glGetUniformLocation(maxPDShader, "projection"), 1, GL_FALSE, &projection[0][0]);
-            glUniform1ui(glGetUniformLocation(maxPDShader, "size"), currentModel->vertices.size());
-            
+            glUniform1ui(0, currentModel->vertices.size());
             currentModel->render(maxPDShader);
 
             glUseProgram(minPDShader);
-            glUniform1f(glGetUniformLocation(minPDShader, "magnitude"), 0.02f* PDLengthScale * currentModel->modelScaleFactor * modelSize);
-            glUniformMatrix4fv(glGetUniformLocation(minPDShader, "model"), 1, GL_FALSE, &model[0][0]);
-            glUniformMatrix4fv(glGetUniformLocation(minPDShader, "view"), 1, GL_FALSE, &view[0][0]);
-            glUniformMatrix4fv(glGetUniformLocation(minPDShader, "projection"), 1, GL_FALSE, &projection[0][0]);
-            glUniform1ui(glGetUniformLocation(minPDShader, "size"), currentModel->vertices.size());
-            
+            glUniform1ui(0, currentModel->vertices.size());
             currentModel->render(minPDShader);
 
         }
 
-        currentModel->render(*currentShader);
+        if (ridgesOn && computeRidgeExtraction) currentModel->renderRidges(ridgeLines);
+        else currentModel->render(*currentShader);
+        frameUniforms().end();
 
         glUseProgram(0);
 
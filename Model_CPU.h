@@ -3,6 +3,7 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <chrono>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
@@ -11,6 +12,7 @@
 #include <assimp/postprocess.h>     
 
 #include "LoadShader.h"
+#include "CurvatureCPU.h"
 bool loadAssimp(const char* path, std::vector<glm::vec3>& out_vertices, std::vector<glm::vec3>& out_normals, std::vector<unsigned int>& out_indices);
 void printVec(glm::vec3 v) {
 	std::cout << "(" << v.x << ", " << v.y << ", " << v.z << ") ";
@@ -36,6 +38,9 @@ public:
 
 	std::vector<glm::vec4> PDs;
 	std::vector<GLfloat> PrincipalCurvatures;
+	std::vector<glm::vec4> dcurvs; //curvature derivatives (C_uuu, C_uuv, C_uvv, C_vvv) in the max / min PDs
+	std::vector<GLfloat> pointAreas;
+	std::vector<GLfloat> cornerAreas;
 
 	std::vector<glm::vec4> maxPDs;
 	std::vector<glm::vec4> minPDs;
@@ -109,7 +114,10 @@ public:
 
 		// Principal Directions / Principal Curvatures (As VBOs)
 		if (this->curvaturesCalculated) {
-			
+			glGenBuffers(1, &maxPDVBO);
+			glGenBuffers(1, &minPDVBO);
+			glGenBuffers(1, &maxCurvVBO);
+			glGenBuffers(1, &minCurvVBO);
 
 			//Send PDs / PCs as attrbutes per vertex, just to uncomplicate some of this process.
 			glBindBuffer(GL_ARRAY_BUFFER, maxPDVBO);
@@ -193,15 +201,21 @@ public:
 		}
 		return minDist;
 	}
-	//Calculates principal curvatures and principal directions per vertex
-	//Using a compute shader with SSBOs
+	//Calculates principal curvatures, principal directions and curvature derivatives per vertex
+	//Computed with CPU c++ code only (CurvatureCPU.h), for comparison with GPU compute shaders and for machines without one.
+	//Same layout as the compute shaders : max PDs / curvatures first, then min (+ size).
 	void setupCurvatures() {
-		//Computed with CPU c++ code only for comparison with GPU compute shaders ----
-		//per face
-		for (int i = 0; i < this->numFaces; i++) {
-
-		}
-
+		if (this->indices.size() < 3) return;
+		auto start = std::chrono::high_resolution_clock::now();
+		VertexCorners corners;
+		buildVertexCorners(this->indices, this->vertices.size(), corners);
+		computePointAreasCPU(this->vertices, this->indices, corners, this->pointAreas, this->cornerAreas);
+		computeCurvaturesCPU(this->vertices, this->normals, this->indices, corners, this->pointAreas, this->cornerAreas, this->PDs, this->PrincipalCurvatures);
+		computeCurvatureDerivativesCPU(this->vertices, this->indices, corners, this->pointAreas, this->cornerAreas, this->PDs, this->PrincipalCurvatures, this->dcurvs);
+		this->curvaturesCalculated = true;
+		std::chrono::duration<double> elapsed_seconds = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "Curvatures for " << this->path << " calculated on the CPU (" << globalThreadPool().size() << " threads). Took "
+			<< elapsed_seconds.count() << " seconds.\n";
 	}
 
 	/*
@@ -226,7 +240,7 @@ public:
 
 		std::cout << "Loading file : " << this->path << ".\n";
 		//aiProcess_Triangulate !!!
-		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace | aiProcess_GenUVCoords); //aiProcess_JoinIdenticalVertices | aiProcess_SortByPType);
+		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace | aiProcess_GenUVCoords); //aiProcess_JoinIdenticalVertices | aiProcess_SortByPType);
 		if (!scene) {
 			fprintf(stderr, importer.GetErrorString());
 			return false;
@@ -258,13 +272,8 @@ public:
 			}
 		}
 		else {
-			//std::cout << "Model has no normals.\n";
-			//mesh->
-			for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-				// std::cout<<"Number of Vertices : "<<mesh->mNumVertices<<"\n";
-				aiVector3D n = mesh->mNormals[i];
-				this->normals.push_back(glm::normalize(glm::vec3(n.x, n.y, n.z)));
-			}
+			//no normals in the file : zero ones, generated once the faces are in
+			this->normals.insert(this->normals.end(), mesh->mNumVertices, glm::vec3(0.0f));
 		}
 		// Fill face indices
 		for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
@@ -275,6 +284,7 @@ public:
 			}
 			this->faces.push_back(fac);
 		}
+		completeVertexNormals(this->vertices, this->indices, this->normals);
 
 		std::cout << "Number of vertices : " << this->vertices.size() << "\n";
 		std::cout << "Number of normals : " << this->normals.size() << "\n";
@@ -306,7 +316,7 @@ bool loadAssimp(
 	Assimp::Importer importer;
 	printf("Loading file : %s...\n", path);
 	//aiProcess_Triangulate !!!
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace | aiProcess_GenUVCoords); //aiProcess_JoinIdenticalVertices | aiProcess_SortByPType);
+	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace | aiProcess_GenUVCoords); //aiProcess_JoinIdenticalVertices | aiProcess_SortByPType);
 	if (!scene) {
 		fprintf(stderr, importer.GetErrorString());
 		return false;
@@ -337,13 +347,8 @@ bool loadAssimp(
 		}
 	}
 	else {
-		//std::cout << "Model has no normals.\n";
-		//mesh->
-		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-			// std::cout<<"Number of Vertices : "<<mesh->mNumVertices<<"\n";
-			aiVector3D n = mesh->mNormals[i];
-			out_normals.push_back(glm::normalize(glm::vec3(n.x, n.y, n.z)));
-		}
+		//no normals in the file : zero ones, generated once the faces are in
+		out_normals.insert(out_normals.end(), mesh->mNumVertices, glm::vec3(0.0f));
 	}
 	// Fill face indices
 	//std::cout << "Number of faces :" << mesh->mNumFaces << "\n";
@@ -352,6 +357,7 @@ bool loadAssimp(
 		for (unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; j++)
 			out_indices.push_back(mesh->mFaces[i].mIndices[j]);
 	}
+	completeVertexNormals(out_vertices, out_indices, out_normals);
 
 	std::cout << "Size of vertices : " << out_vertices.size() << "\n";
 	std::cout << "Size of normals : " << out_normals.size() << "\n";
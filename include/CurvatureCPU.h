@@ -0,0 +1,315 @@
+#ifndef CURVATURE_CPU_H
+#define CURVATURE_CPU_H
+//CPU version of the load time curvature passes, for machines without a GPU and for checking the compute shaders.
+//Same method as pointAreas.compute, curvature_perFace.compute, curvature_perVertex.compute and dcurv_perFace.compute
+//("Estimating Curvatures and Their Derivatives on Triangle Meshes", Rusinkiewicz), same output layout :
+//PDs holds max directions then min directions (vec4, w = 0), curvatures holds max then min curvatures,
+//dcurv one vec4 per vertex.
+//Faces and vertices are split over the thread pool. Per face results are written per corner and every vertex
+//gathers its own over its corner list (VertexCorners), so nothing is shared between threads and results are
+//bit for bit the same on every run.
+//The per face step is vectorized in CurvatureSIMD.h.
+//Every pass is templated on the scalar type T of its results : float in production (SIMD per face step),
+//double for validation runs. Mesh positions and normals stay float and are converted as they're read.
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "ThreadPool.h"
+#include "MeshProcessing.h"
+#include "CurvatureSIMD.h"
+
+template<typename T> using CurvatureVec3 = glm::vec<3, T, glm::defaultp>;
+template<typename T> using CurvatureVec4 = glm::vec<4, T, glm::defaultp>;
+
+//Sum of values over the corners of vertex v, in corner order.
+template<typename V>
+inline V gatherCorners(const VertexCorners& corners, size_t v, const V* values) {
+	V sum = V(0.0f);
+	for (uint32_t k = corners.offsets[v]; k < corners.offsets[v + 1]; k++) sum += values[corners.corners[k]];
+	return sum;
+}
+
+//Voronoi area of every corner (Meyer et al. with the obtuse triangle fix) and their sum per vertex.
+//cornerAreas has one entry per index, pointAreas one per vertex.
+template<typename T>
+inline void computePointAreasCPU(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, const VertexCorners& corners,
+	std::vector<T>& pointAreas, std::vector<T>& cornerAreas) {
+	typedef CurvatureVec3<T> Vec3;
+	const size_t faceCount = indices.size() / 3;
+	cornerAreas.assign(3 * faceCount, T(0));
+	ThreadPool& pool = globalThreadPool();
+	pool.parallelFor(0, faceCount, 1 << 12, [&](size_t begin, size_t end) {
+		for (size_t f = begin; f < end; f++) {
+			const unsigned int* face = &indices[3 * f];
+			const Vec3 p[3] = { Vec3(vertices[face[0]]), Vec3(vertices[face[1]]), Vec3(vertices[face[2]]) };
+			const Vec3 edges[3] = { p[2] - p[1], p[0] - p[2], p[1] - p[0] };
+			const T area = T(0.5) * glm::length(glm::cross(edges[0], edges[1]));
+			const T length2[3] = { glm::dot(edges[0], edges[0]), glm::dot(edges[1], edges[1]), glm::dot(edges[2], edges[2]) };
+			//barycentric weights of the circumcenter
+			const T weights[3] = {
+				length2[0] * (length2[1] + length2[2] - length2[0]),
+				length2[1] * (length2[2] + length2[0] - length2[1]),
+				length2[2] * (length2[0] + length2[1] - length2[2])
+			};
+			T* corner = &cornerAreas[3 * f];
+			if (weights[0] <= T(0)) {
+				corner[1] = T(-0.25) * length2[2] * area / glm::dot(edges[0], edges[2]);
+				corner[2] = T(-0.25) * length2[1] * area / glm::dot(edges[0], edges[1]);
+				corner[0] = area - corner[1] - corner[2];
+			}
+			else if (weights[1] <= T(0)) {
+				corner[2] = T(-0.25) * length2[0] * area / glm::dot(edges[1], edges[0]);
+				corner[0] = T(-0.25) * length2[2] * area / glm::dot(edges[1], edges[2]);
+				corner[1] = area - corner[2] - corner[0];
+			}
+			else if (weights[2] <= T(0)) {
+				corner[0] = T(-0.25) * length2[1] * area / glm::dot(edges[2], edges[1]);
+				corner[1] = T(-0.25) * length2[0] * area / glm::dot(edges[2], edges[0]);
+				corner[2] = area - corner[0] - corner[1];
+			}
+			else {
+				const T scale = T(0.5) * area / (weights[0] + weights[1] + weights[2]);
+				for (int j = 0; j < 3; j++) corner[j] = scale * (weights[(j + 1) % 3] + weights[(j + 2) % 3]);
+			}
+		}
+	});
+	pointAreas.resize(vertices.size());
+	pool.parallelFor(0, vertices.size(), 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) pointAreas[i] = gatherCorners(corners, i, cornerAreas.data());
+	});
+}
+
+//Rotates the basis (oldU, oldV) so it's perpendicular to newNormal.
+template<typename T>
+inline void rotateCoordinateSystem(const CurvatureVec3<T>& oldU, const CurvatureVec3<T>& oldV, const CurvatureVec3<T>& newNormal,
+	CurvatureVec3<T>& newU, CurvatureVec3<T>& newV) {
+	newU = oldU;
+	newV = oldV;
+	const CurvatureVec3<T> oldNormal = glm::cross(oldU, oldV);
+	const T ndot = glm::dot(oldNormal, newNormal);
+	if (ndot <= T(-1)) {
+		newU = -newU;
+		newV = -newV;
+		return;
+	}
+	//perpendicular to oldNormal in the plane of both normals, and the difference of the perpendiculars
+	const CurvatureVec3<T> perpendicularToOld = newNormal - ndot * oldNormal;
+	const CurvatureVec3<T> differencePerpendicular = T(1) / (T(1) + ndot) * (oldNormal + newNormal);
+	newU -= differencePerpendicular * glm::dot(newU, perpendicularToOld);
+	newV -= differencePerpendicular * glm::dot(newV, perpendicularToOld);
+}
+
+//Unit normals, the initial per vertex frame and the point areas, as the per face kernels read them.
+//The frame is the edge to the next corner of the vertex's last corner, made perpendicular to the normal
+//(same as curvature_frames.compute).
+template<typename T>
+inline void buildCurvatureVertexSoA(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals, const std::vector<unsigned int>& indices,
+	const VertexCorners& corners, const std::vector<T>& pointAreas, BasicCurvatureVertexSoA<T>& soa) {
+	typedef CurvatureVec3<T> Vec3;
+	const size_t vertexCount = vertices.size();
+	soa.resize(vertexCount);
+	globalThreadPool().parallelFor(0, vertexCount, 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const Vec3 p(vertices[i]);
+			const Vec3 n = glm::normalize(Vec3(normals[i]));
+			Vec3 u(T(0));
+			if (corners.offsets[i + 1] > corners.offsets[i]) {
+				const uint32_t c = corners.corners[corners.offsets[i + 1] - 1];
+				u = glm::cross(Vec3(vertices[indices[c - c % 3 + (c + 1) % 3]]) - p, n);
+			}
+			if (glm::dot(u, u) == T(0)) u = glm::cross(std::abs(n.x) < T(0.9) ? Vec3(T(1), T(0), T(0)) : Vec3(T(0), T(1), T(0)), n);
+			u = glm::normalize(u);
+			const Vec3 v = glm::cross(n, u);
+			soa.x[i] = p.x; soa.y[i] = p.y; soa.z[i] = p.z;
+			soa.nx[i] = n.x; soa.ny[i] = n.y; soa.nz[i] = n.z;
+			soa.u1x[i] = u.x; soa.u1y[i] = u.y; soa.u1z[i] = u.z;
+			soa.u2x[i] = v.x; soa.u2y[i] = v.y; soa.u2z[i] = v.z;
+			soa.pointArea[i] = pointAreas[i];
+		}
+	});
+}
+
+//Principal curvatures and directions per vertex.
+//The per vertex basis is taken from the vertex's last corner and sums are gathered in corner order, so results don't depend on the thread count.
+//The per face step runs on the widest instruction set available (CurvatureSIMD.h) unless level says otherwise,
+//in double precision it always runs scalar.
+template<typename T>
+inline void computeCurvaturesCPU(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals, const std::vector<unsigned int>& indices,
+	const VertexCorners& corners, const std::vector<T>& pointAreas, const std::vector<T>& cornerAreas, std::vector<CurvatureVec4<T>>& PDs, std::vector<T>& curvatures,
+	SimdLevel level = SIMD_AVX512) {
+	typedef CurvatureVec3<T> Vec3;
+	const size_t vertexCount = vertices.size();
+	const size_t faceCount = indices.size() / 3;
+	ThreadPool& pool = globalThreadPool();
+
+	BasicCurvatureVertexSoA<T> soa;
+	buildCurvatureVertexSoA(vertices, normals, indices, corners, pointAreas, soa);
+
+	//per face : least squares fit of the second fundamental form from the normal differences along the edges,
+	//projected into every corner's vertex basis and weighted by its share of the vertex area
+	std::vector<T> cornerCurv1(3 * faceCount), cornerCurv12(3 * faceCount), cornerCurv2(3 * faceCount);
+	pool.parallelFor(0, faceCount, 1 << 12, [&](size_t begin, size_t end) {
+		perFaceCurvatures(level, soa, indices.data(), cornerAreas.data(), begin, end, cornerCurv1.data(), cornerCurv12.data(), cornerCurv2.data());
+	});
+
+	//per vertex : gather the corner contributions, then a Jacobi rotation diagonalizing the tensor, max curvature first
+	PDs.resize(2 * vertexCount);
+	curvatures.resize(2 * vertexCount);
+	pool.parallelFor(0, vertexCount, 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const Vec3 n(soa.nx[i], soa.ny[i], soa.nz[i]);
+			T k1 = gatherCorners(corners, i, cornerCurv1.data());
+			T k12 = gatherCorners(corners, i, cornerCurv12.data());
+			T k2 = gatherCorners(corners, i, cornerCurv2.data());
+			Vec3 oldU, oldV;
+			rotateCoordinateSystem(Vec3(soa.u1x[i], soa.u1y[i], soa.u1z[i]), Vec3(soa.u2x[i], soa.u2y[i], soa.u2z[i]), n, oldU, oldV);
+			T c = T(1), s = T(0), tt = T(0);
+			if (k12 != T(0)) {
+				const T h = T(0.5) * (k2 - k1) / k12;
+				tt = (h < T(0)) ? T(1) / (h - std::sqrt(T(1) + h * h)) : T(1) / (h + std::sqrt(T(1) + h * h));
+				c = T(1) / std::sqrt(T(1) + tt * tt);
+				s = tt * c;
+			}
+			k1 = k1 - tt * k12;
+			k2 = k2 + tt * k12;
+			Vec3 maxDirection;
+			if (std::abs(k1) >= std::abs(k2)) maxDirection = c * oldU - s * oldV;
+			else {
+				std::swap(k1, k2);
+				maxDirection = s * oldU + c * oldV;
+			}
+			const Vec3 minDirection = glm::cross(n, maxDirection);
+			PDs[i] = CurvatureVec4<T>(glm::normalize(maxDirection), T(0));
+			PDs[i + vertexCount] = CurvatureVec4<T>(glm::normalize(minDirection), T(0));
+			curvatures[i] = k1;
+			curvatures[i + vertexCount] = k2;
+		}
+	});
+}
+
+//LDLT decomposition of a symmetric positive definite 4x4 matrix, only the upper triangle of A is read.
+//L goes below the diagonal of A, rdiag gets the reciprocals of D. False if A isn't positive definite.
+template<typename T>
+inline bool ldltDecompose4(T A[4][4], T rdiag[4]) {
+	T v[3];
+	for (int i = 0; i < 4; i++) {
+		for (int k = 0; k < i; k++) v[k] = A[i][k] * rdiag[k];
+		for (int j = i; j < 4; j++) {
+			T sum = A[i][j];
+			for (int k = 0; k < i; k++) sum -= v[k] * A[j][k];
+			if (i == j) {
+				if (sum <= T(0)) return false;
+				rdiag[i] = T(1) / sum;
+			}
+			else A[j][i] = sum;
+		}
+	}
+	return true;
+}
+template<typename T>
+inline void ldltSolve4(const T A[4][4], const T rdiag[4], const T b[4], T x[4]) {
+	for (int i = 0; i < 4; i++) {
+		T sum = b[i];
+		for (int k = 0; k < i; k++) sum -= A[i][k] * x[k];
+		x[i] = sum * rdiag[i];
+	}
+	for (int i = 3; i >= 0; i--) {
+		T sum = T(0);
+		for (int k = i + 1; k < 4; k++) sum += A[k][i] * x[k];
+		x[i] -= sum * rdiag[i];
+	}
+}
+
+//Re-expresses the curvature tensor (ku, kuv, kv) given in basis (oldU, oldV) in basis (newU, newV).
+template<typename T>
+inline CurvatureVec3<T> projectCurvatureTensor(const CurvatureVec3<T>& oldU, const CurvatureVec3<T>& oldV, const CurvatureVec3<T>& tensor,
+	const CurvatureVec3<T>& newU, const CurvatureVec3<T>& newV) {
+	CurvatureVec3<T> u, v;
+	rotateCoordinateSystem(newU, newV, glm::cross(oldU, oldV), u, v);
+	const T u1 = glm::dot(u, oldU), v1 = glm::dot(u, oldV), u2 = glm::dot(v, oldU), v2 = glm::dot(v, oldV);
+	return CurvatureVec3<T>(
+		tensor.x * u1 * u1 + tensor.y * (T(2) * u1 * v1) + tensor.z * v1 * v1,
+		tensor.x * u1 * u2 + tensor.y * (u1 * v2 + u2 * v1) + tensor.z * v1 * v2,
+		tensor.x * u2 * u2 + tensor.y * (T(2) * u2 * v2) + tensor.z * v2 * v2);
+}
+//Same for the curvature derivative (C_uuu, C_uuv, C_uvv, C_vvv).
+template<typename T>
+inline CurvatureVec4<T> projectCurvatureDerivative(const CurvatureVec3<T>& oldU, const CurvatureVec3<T>& oldV, const CurvatureVec4<T>& d,
+	const CurvatureVec3<T>& newU, const CurvatureVec3<T>& newV) {
+	CurvatureVec3<T> u, v;
+	rotateCoordinateSystem(newU, newV, glm::cross(oldU, oldV), u, v);
+	const T u1 = glm::dot(u, oldU), v1 = glm::dot(u, oldV), u2 = glm::dot(v, oldU), v2 = glm::dot(v, oldV);
+	return CurvatureVec4<T>(
+		d.x * u1 * u1 * u1 + d.y * T(3) * u1 * u1 * v1 + d.z * T(3) * u1 * v1 * v1 + d.w * v1 * v1 * v1,
+		d.x * u1 * u1 * u2 + d.y * (u1 * u1 * v2 + T(2) * u2 * u1 * v1) + d.z * (u2 * v1 * v1 + T(2) * u1 * v1 * v2) + d.w * v1 * v1 * v2,
+		d.x * u1 * u2 * u2 + d.y * (u2 * u2 * v1 + T(2) * u1 * u2 * v2) + d.z * (u1 * v2 * v2 + T(2) * u2 * v2 * v1) + d.w * v1 * v2 * v2,
+		d.x * u2 * u2 * u2 + d.y * T(3) * u2 * u2 * v2 + d.z * T(3) * u2 * v2 * v2 + d.w * v2 * v2 * v2);
+}
+
+//Derivative of the curvature tensor per vertex (C_uuu, C_uuv, C_uvv, C_vvv), in the vertex's (max, min) principal directions.
+//Per face : least squares fit from the differences of the vertex curvature tensors along the edges, projected back into
+//every corner's principal directions and weighted like the curvatures. Per vertex : gathered over the corner list.
+template<typename T>
+inline void computeCurvatureDerivativesCPU(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, const VertexCorners& corners,
+	const std::vector<T>& pointAreas, const std::vector<T>& cornerAreas, const std::vector<CurvatureVec4<T>>& PDs, const std::vector<T>& curvatures,
+	std::vector<CurvatureVec4<T>>& dcurv) {
+	typedef CurvatureVec3<T> Vec3;
+	typedef CurvatureVec4<T> Vec4;
+	const size_t vertexCount = vertices.size();
+	const size_t faceCount = indices.size() / 3;
+	ThreadPool& pool = globalThreadPool();
+
+	std::vector<Vec4> cornerDcurv(3 * faceCount);
+	pool.parallelFor(0, faceCount, 1 << 12, [&](size_t begin, size_t end) {
+		for (size_t f = begin; f < end; f++) {
+			const unsigned int* face = &indices[3 * f];
+			const Vec3 p[3] = { Vec3(vertices[face[0]]), Vec3(vertices[face[1]]), Vec3(vertices[face[2]]) };
+			const Vec3 edges[3] = { p[2] - p[1], p[0] - p[2], p[1] - p[0] };
+			const Vec3 t = glm::normalize(edges[0]);
+			const Vec3 b = glm::normalize(glm::cross(glm::cross(edges[0], edges[1]), t));
+			Vec3 faceCurv[3];
+			for (int j = 0; j < 3; j++) {
+				const size_t v = face[j];
+				faceCurv[j] = projectCurvatureTensor(Vec3(PDs[v]), Vec3(PDs[v + vertexCount]),
+					Vec3(curvatures[v], T(0), curvatures[v + vertexCount]), t, b);
+			}
+			T m[4] = { T(0), T(0), T(0), T(0) };
+			T w[4][4] = {};
+			for (int j = 0; j < 3; j++) {
+				const Vec3 dfcurv = faceCurv[(j + 2) % 3] - faceCurv[(j + 1) % 3];
+				const T u = glm::dot(edges[j], t), v = glm::dot(edges[j], b);
+				w[0][0] += u * u;
+				w[0][1] += u * v;
+				w[3][3] += v * v;
+				m[0] += u * dfcurv.x;
+				m[1] += v * dfcurv.x + T(2) * u * dfcurv.y;
+				m[2] += T(2) * v * dfcurv.y + u * dfcurv.z;
+				m[3] += v * dfcurv.z;
+			}
+			w[1][1] = T(2) * w[0][0] + w[3][3];
+			w[1][2] = T(2) * w[0][1];
+			w[2][2] = w[0][0] + T(2) * w[3][3];
+			w[2][3] = w[0][1];
+			T rdiag[4], x[4];
+			const bool solvable = ldltDecompose4(w, rdiag);
+			if (solvable) ldltSolve4(w, rdiag, m, x);
+			const Vec4 faceDcurv = solvable ? Vec4(x[0], x[1], x[2], x[3]) : Vec4(T(0));
+			for (int j = 0; j < 3; j++) {
+				const size_t v = face[j];
+				const T pointArea = pointAreas[v];
+				cornerDcurv[3 * f + j] = (solvable && pointArea > T(0))
+					? cornerAreas[3 * f + j] / pointArea * projectCurvatureDerivative(t, b, faceDcurv, Vec3(PDs[v]), Vec3(PDs[v + vertexCount]))
+					: Vec4(T(0));
+			}
+		}
+	});
+	dcurv.resize(vertexCount);
+	pool.parallelFor(0, vertexCount, 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) dcurv[i] = gatherCorners(corners, i, cornerDcurv.data());
+	});
+}
+
+#endif
@@ -0,0 +1,276 @@
+#ifndef CURVATURE_SIMD_H
+#define CURVATURE_SIMD_H
+//Per face step of the CPU curvature pipeline (see CurvatureCPU.h), several faces per instruction.
+//Vertex data is laid out as structure of arrays, CurvatureSIMDKernel.h is compiled once per instruction set
+//(scalar, SSE4.1, AVX2, AVX-512) and the widest one the CPU and OS support is picked at runtime.
+//A double precision scalar build of the same kernel backs the validation runs.
+//Every corner's weighted contribution is written to per corner arrays, summing them per vertex is up to the caller.
+#include <vector>
+#include <string>
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CURVATURE_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define CURVATURE_SIMD_X86 0
+#endif
+
+//MSVC compiles intrinsics of any instruction set anywhere, GCC / Clang need the target enabled per function.
+#if defined(__clang__)
+#define CURVATURE_TARGET_PUSH(isa) _Pragma("clang attribute push(__attribute__((target(" #isa "))), apply_to = function)")
+#define CURVATURE_TARGET_POP _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define CURVATURE_TARGET_PRAGMA(text) _Pragma(#text)
+#define CURVATURE_TARGET_PUSH(isa) _Pragma("GCC push_options") CURVATURE_TARGET_PRAGMA(GCC target(isa))
+#define CURVATURE_TARGET_POP _Pragma("GCC pop_options")
+#else
+#define CURVATURE_TARGET_PUSH(isa)
+#define CURVATURE_TARGET_POP
+#endif
+
+//Everything the per face step reads per vertex.
+template<typename T>
+struct BasicCurvatureVertexSoA {
+	std::vector<T> x, y, z;        //positions
+	std::vector<T> nx, ny, nz;     //unit normals
+	std::vector<T> u1x, u1y, u1z;  //initial frame, first direction
+	std::vector<T> u2x, u2y, u2z;  //initial frame, second direction
+	std::vector<T> pointArea;
+	void resize(size_t n) {
+		for (std::vector<T>* a : { &x, &y, &z, &nx, &ny, &nz, &u1x, &u1y, &u1z, &u2x, &u2y, &u2z, &pointArea }) a->resize(n);
+	}
+};
+typedef BasicCurvatureVertexSoA<float> CurvatureVertexSoA;
+
+enum SimdLevel { SIMD_SCALAR, SIMD_SSE4, SIMD_AVX2, SIMD_AVX512 };
+inline const char* simdLevelName(SimdLevel level) {
+	static const char* names[] = { "scalar", "SSE4.1", "AVX2", "AVX-512" };
+	return names[level];
+}
+inline int simdLevelWidth(SimdLevel level) {
+	static const int widths[] = { 1, 4, 8, 16 };
+	return widths[level];
+}
+
+//Widest instruction set usable here : CPUID for the CPU, XGETBV for the OS saving the wider registers.
+inline SimdLevel detectSimdLevel() {
+#if CURVATURE_SIMD_X86
+	auto cpuid = [](unsigned int leaf, unsigned int subleaf, unsigned int out[4]) {
+#if defined(_MSC_VER)
+		int registers[4];
+		__cpuidex(registers, int(leaf), int(subleaf));
+		for (int i = 0; i < 4; i++) out[i] = unsigned(registers[i]);
+#else
+		__cpuid_count(leaf, subleaf, out[0], out[1], out[2], out[3]);
+#endif
+	};
+	unsigned int r[4];
+	cpuid(0, 0, r);
+	const unsigned int maxLeaf = r[0];
+	if (maxLeaf < 1) return SIMD_SCALAR;
+	cpuid(1, 0, r);
+	const bool sse41 = (r[2] >> 19) & 1, osxsave = (r[2] >> 27) & 1, avx = (r[2] >> 28) & 1;
+	if (!sse41) return SIMD_SCALAR;
+	if (!osxsave || !avx || maxLeaf < 7) return SIMD_SSE4;
+#if defined(_MSC_VER)
+	const unsigned long long xcr0 = _xgetbv(0);
+#else
+	unsigned int xcr0Low, xcr0High;
+	__asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+	const unsigned long long xcr0 = (unsigned long long)(xcr0High) << 32 | xcr0Low;
+#endif
+	cpuid(7, 0, r);
+	const bool avx2 = (r[1] >> 5) & 1, avx512 = (r[1] >> 16) & 1;
+	if ((xcr0 & 0x6) != 0x6 || !avx2) return SIMD_SSE4;
+	if ((xcr0 & 0xe6) != 0xe6 || !avx512) return SIMD_AVX2;
+	return SIMD_AVX512;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+inline SimdLevel cpuSimdLevel() {
+	static const SimdLevel level = detectSimdLevel();
+	return level;
+}
+
+namespace curvature_scalar {
+	typedef float Scalar;
+	typedef float Pack;
+	typedef bool Mask;
+	const int width = 1;
+	inline Pack set1(float v) { return v; }
+	inline Pack load(const float* p) { return *p; }
+	inline Pack gather(const float* base, const int32_t* lanes) { return base[lanes[0]]; }
+	inline void store(float* p, Pack v) { *p = v; }
+	inline Pack sqrtp(Pack v) { return std::sqrt(v); }
+	inline Mask greaterThan(Pack a, Pack b) { return a > b; }
+	inline Mask lessEqual(Pack a, Pack b) { return a <= b; }
+	inline Mask both(Mask a, Mask b) { return a && b; }
+	inline Pack select(Mask m, Pack a, Pack b) { return m ? a : b; }
+	//the kernel's tail call, only reached from the wider instruction sets
+	inline void perFaceCurvatures(const CurvatureVertexSoA& soa, const unsigned int* indices, const float* cornerAreas, size_t begin, size_t end,
+		float* cornerCurv1, float* cornerCurv12, float* cornerCurv2);
+	namespace tail = curvature_scalar;
+#include "CurvatureSIMDKernel.h"
+}
+
+//Same kernel in double precision, one face at a time, for validation runs (see CurvatureCPU.h).
+namespace curvature_double {
+	typedef double Scalar;
+	typedef double Pack;
+	typedef bool Mask;
+	const int width = 1;
+	inline Pack set1(double v) { return v; }
+	inline Pack load(const double* p) { return *p; }
+	inline Pack gather(const double* base, const int32_t* lanes) { return base[lanes[0]]; }
+	inline void store(double* p, Pack v) { *p = v; }
+	inline Pack sqrtp(Pack v) { return std::sqrt(v); }
+	inline Mask greaterThan(Pack a, Pack b) { return a > b; }
+	inline Mask lessEqual(Pack a, Pack b) { return a <= b; }
+	inline Mask both(Mask a, Mask b) { return a && b; }
+	inline Pack select(Mask m, Pack a, Pack b) { return m ? a : b; }
+	namespace tail = curvature_double;
+#include "CurvatureSIMDKernel.h"
+}
+
+#if CURVATURE_SIMD_X86
+CURVATURE_TARGET_PUSH("sse4.1")
+namespace curvature_sse4 {
+	typedef float Scalar;
+	struct Pack { __m128 v; };
+	struct Mask { __m128 v; };
+	const int width = 4;
+	inline Pack operator+(Pack a, Pack b) { return { _mm_add_ps(a.v, b.v) }; }
+	inline Pack operator-(Pack a, Pack b) { return { _mm_sub_ps(a.v, b.v) }; }
+	inline Pack operator*(Pack a, Pack b) { return { _mm_mul_ps(a.v, b.v) }; }
+	inline Pack operator/(Pack a, Pack b) { return { _mm_div_ps(a.v, b.v) }; }
+	inline Pack set1(float v) { return { _mm_set1_ps(v) }; }
+	inline Pack load(const float* p) { return { _mm_loadu_ps(p) }; }
+	inline Pack gather(const float* base, const int32_t* lanes) { return { _mm_set_ps(base[lanes[3]], base[lanes[2]], base[lanes[1]], base[lanes[0]]) }; }
+	inline void store(float* p, Pack v) { _mm_storeu_ps(p, v.v); }
+	inline Pack sqrtp(Pack v) { return { _mm_sqrt_ps(v.v) }; }
+	inline Mask greaterThan(Pack a, Pack b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+	inline Mask lessEqual(Pack a, Pack b) { return { _mm_cmple_ps(a.v, b.v) }; }
+	inline Mask both(Mask a, Mask b) { return { _mm_and_ps(a.v, b.v) }; }
+	inline Pack select(Mask m, Pack a, Pack b) { return { _mm_blendv_ps(b.v, a.v, m.v) }; }
+	namespace tail = curvature_scalar;
+#include "CurvatureSIMDKernel.h"
+}
+CURVATURE_TARGET_POP
+
+CURVATURE_TARGET_PUSH("avx2")
+namespace curvature_avx2 {
+	typedef float Scalar;
+	struct Pack { __m256 v; };
+	struct Mask { __m256 v; };
+	const int width = 8;
+	inline Pack operator+(Pack a, Pack b) { return { _mm256_add_ps(a.v, b.v) }; }
+	inline Pack operator-(Pack a, Pack b) { return { _mm256_sub_ps(a.v, b.v) }; }
+	inline Pack operator*(Pack a, Pack b) { return { _mm256_mul_ps(a.v, b.v) }; }
+	inline Pack operator/(Pack a, Pack b) { return { _mm256_div_ps(a.v, b.v) }; }
+	inline Pack set1(float v) { return { _mm256_set1_ps(v) }; }
+	inline Pack load(const float* p) { return { _mm256_loadu_ps(p) }; }
+	inline Pack gather(const float* base, const int32_t* lanes) {
+		return { _mm256_i32gather_ps(base, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes)), 4) };
+	}
+	inline void store(float* p, Pack v) { _mm256_storeu_ps(p, v.v); }
+	inline Pack sqrtp(Pack v) { return { _mm256_sqrt_ps(v.v) }; }
+	inline Mask greaterThan(Pack a, Pack b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+	inline Mask lessEqual(Pack a, Pack b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+	inline Mask both(Mask a, Mask b) { return { _mm256_and_ps(a.v, b.v) }; }
+	inline Pack select(Mask m, Pack a, Pack b) { return { _mm256_blendv_ps(b.v, a.v, m.v) }; }
+	namespace tail = curvature_scalar;
+#include "CurvatureSIMDKernel.h"
+}
+CURVATURE_TARGET_POP
+
+CURVATURE_TARGET_PUSH("avx512f")
+namespace curvature_avx512 {
+	typedef float Scalar;
+	struct Pack { __m512 v; };
+	struct Mask { __mmask16 v; };
+	const int width = 16;
+	inline Pack operator+(Pack a, Pack b) { return { _mm512_add_ps(a.v, b.v) }; }
+	inline Pack operator-(Pack a, Pack b) { return { _mm512_sub_ps(a.v, b.v) }; }
+	inline Pack operator*(Pack a, Pack b) { return { _mm512_mul_ps(a.v, b.v) }; }
+	inline Pack operator/(Pack a, Pack b) { return { _mm512_div_ps(a.v, b.v) }; }
+	inline Pack set1(float v) { return { _mm512_set1_ps(v) }; }
+	inline Pack load(const float* p) { return { _mm512_loadu_ps(p) }; }
+	//masked forms with a zero source : GCC warns about the undefined source of the plain ones
+	inline Pack gather(const float* base, const int32_t* lanes) {
+		return { _mm512_mask_i32gather_ps(_mm512_setzero_ps(), __mmask16(0xffff), _mm512_loadu_si512(lanes), base, 4) };
+	}
+	inline void store(float* p, Pack v) { _mm512_storeu_ps(p, v.v); }
+	inline Pack sqrtp(Pack v) { return { _mm512_mask_sqrt_ps(_mm512_setzero_ps(), __mmask16(0xffff), v.v) }; }
+	inline Mask greaterThan(Pack a, Pack b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ) }; }
+	inline Mask lessEqual(Pack a, Pack b) { return { _mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ) }; }
+	inline Mask both(Mask a, Mask b) { return { __mmask16(a.v & b.v) }; }
+	inline Pack select(Mask m, Pack a, Pack b) { return { _mm512_mask_blend_ps(m.v, b.v, a.v) }; }
+	namespace tail = curvature_scalar;
+#include "CurvatureSIMDKernel.h"
+}
+CURVATURE_TARGET_POP
+#endif
+
+//Runs the kernel for one instruction set (clamped to what the CPU supports) over faces [begin, end).
+inline void perFaceCurvatures(SimdLevel level, const CurvatureVertexSoA& soa, const unsigned int* indices, const float* cornerAreas,
+	size_t begin, size_t end, float* cornerCurv1, float* cornerCurv12, float* cornerCurv2) {
+	level = std::min(level, cpuSimdLevel());
+	switch (level) {
+#if CURVATURE_SIMD_X86
+	case SIMD_AVX512: curvature_avx512::perFaceCurvatures(soa, indices, cornerAreas, begin, end, cornerCurv1, cornerCurv12, cornerCurv2); break;
+	case SIMD_AVX2: curvature_avx2::perFaceCurvatures(soa, indices, cornerAreas, begin, end, cornerCurv1, cornerCurv12, cornerCurv2); break;
+	case SIMD_SSE4: curvature_sse4::perFaceCurvatures(soa, indices, cornerAreas, begin, end, cornerCurv1, cornerCurv12, cornerCurv2); break;
+#endif
+	default: curvature_scalar::perFaceCurvatures(soa, indices, cornerAreas, begin, end, cornerCurv1, cornerCurv12, cornerCurv2); break;
+	}
+}
+//Double precision has a single scalar version, level is ignored. Picked by overload, not at runtime.
+inline void perFaceCurvatures(SimdLevel, const BasicCurvatureVertexSoA<double>& soa, const unsigned int* indices, const double* cornerAreas,
+	size_t begin, size_t end, double* cornerCurv1, double* cornerCurv12, double* cornerCurv2) {
+	curvature_double::perFaceCurvatures(soa, indices, cornerAreas, begin, end, cornerCurv1, cornerCurv12, cornerCurv2);
+}
+
+//Single thread faces/s of every supported instruction set, and the largest difference to the scalar result.
+inline void benchmarkPerFaceKernels(const std::string& name, const CurvatureVertexSoA& soa, const std::vector<unsigned int>& indices,
+	const std::vector<float>& cornerAreas, int runs = 5) {
+	const size_t faceCount = indices.size() / 3;
+	if (faceCount == 0) return;
+	std::vector<float> reference[3], result[3];
+	for (int k = 0; k < 3; k++) { reference[k].resize(3 * faceCount); result[k].resize(3 * faceCount); }
+	std::cout << "Per face curvature kernel benchmark " << name << " (" << faceCount << " faces, best of " << runs << ", one thread, CPU supports "
+		<< simdLevelName(cpuSimdLevel()) << ")\n";
+	double scalarRate = 0.0;
+	for (int l = SIMD_SCALAR; l <= int(cpuSimdLevel()); l++) {
+		const SimdLevel level = SimdLevel(l);
+		std::vector<float>* out = (level == SIMD_SCALAR) ? reference : result;
+		double best = 1e30;
+		for (int run = 0; run < runs; run++) {
+			auto start = std::chrono::high_resolution_clock::now();
+			perFaceCurvatures(level, soa, indices.data(), cornerAreas.data(), 0, faceCount, out[0].data(), out[1].data(), out[2].data());
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			best = std::min(best, elapsed.count());
+		}
+		float difference = 0.0f;
+		if (level != SIMD_SCALAR) {
+			for (int k = 0; k < 3; k++)
+				for (size_t i = 0; i < 3 * faceCount; i++) difference = std::max(difference, std::abs(result[k][i] - reference[k][i]));
+		}
+		const double rate = faceCount / best;
+		if (level == SIMD_SCALAR) scalarRate = rate;
+		std::cout << "  " << simdLevelName(level) << " (" << simdLevelWidth(level) << " lanes) : " << rate / 1e6 << " M faces/s per core ("
+			<< rate / scalarRate << "x), max difference to scalar " << difference << "\n";
+	}
+}
+
+#endif
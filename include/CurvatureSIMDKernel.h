@@ -0,0 +1,107 @@
+//Per face curvature kernel, written once over a lane type and included by CurvatureSIMD.h inside one namespace per
+//instruction set and scalar type. That namespace defines Scalar, Pack (width Scalars), Mask, set1 / gather / sqrtp /
+//greaterThan / lessEqual / both / select / store, and tail, the namespace finishing the faces left over after the
+//last whole pack. No include guard : it is meant to be included several times.
+
+struct V3 { Pack x, y, z; };
+inline V3 operator+(const V3& a, const V3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+inline V3 operator-(const V3& a, const V3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+inline V3 operator*(const V3& a, const Pack& s) { return { a.x * s, a.y * s, a.z * s }; }
+inline Pack dot(const V3& a, const V3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline V3 cross(const V3& a, const V3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+inline V3 normalize(const V3& a) { return a * (set1(1.0f) / sqrtp(dot(a, a))); }
+inline V3 gatherV3(const Scalar* x, const Scalar* y, const Scalar* z, const int32_t* lanes) { return { gather(x, lanes), gather(y, lanes), gather(z, lanes) }; }
+inline V3 select(const Mask& m, const V3& a, const V3& b) { return { select(m, a.x, b.x), select(m, a.y, b.y), select(m, a.z, b.z) }; }
+
+//Faces [first, first + width) : same math as curvature_perFace.compute, one result per corner.
+inline void perFaceLanes(const BasicCurvatureVertexSoA<Scalar>& soa, const unsigned int* indices, const Scalar* cornerAreas, size_t first,
+	Scalar* cornerCurv1, Scalar* cornerCurv12, Scalar* cornerCurv2) {
+	int32_t vertex[3][width];
+	Scalar corner[3][width];
+	for (int l = 0; l < width; l++) {
+		for (int j = 0; j < 3; j++) {
+			vertex[j][l] = int32_t(indices[3 * (first + l) + j]);
+			corner[j][l] = cornerAreas[3 * (first + l) + j];
+		}
+	}
+	V3 p[3], n[3];
+	for (int j = 0; j < 3; j++) {
+		p[j] = gatherV3(soa.x.data(), soa.y.data(), soa.z.data(), vertex[j]);
+		n[j] = gatherV3(soa.nx.data(), soa.ny.data(), soa.nz.data(), vertex[j]);
+	}
+	const V3 edges[3] = { p[2] - p[1], p[0] - p[2], p[1] - p[0] };
+	const V3 t = normalize(edges[0]);
+	const V3 b = normalize(cross(cross(edges[0], edges[1]), t));
+
+	//normal equations of the fit, w02 is always 0
+	const Pack zero = set1(0.0f);
+	Pack m0 = zero, m1 = zero, m2 = zero, w00 = zero, w01 = zero, w22 = zero;
+	for (int j = 0; j < 3; j++) {
+		const Pack u = dot(edges[j], t), v = dot(edges[j], b);
+		w00 = w00 + u * u;
+		w01 = w01 + u * v;
+		w22 = w22 + v * v;
+		const V3 dn = n[(j + 2) % 3] - n[(j + 1) % 3];
+		const Pack dnu = dot(dn, t), dnv = dot(dn, b);
+		m0 = m0 + dnu * u;
+		m1 = m1 + dnu * v + dnv * u;
+		m2 = m2 + dnv * v;
+	}
+	const Pack w11 = w00 + w22, w12 = w01;
+	//LDLT decomposition and solve unrolled for this sparsity, non positive pivots mean a degenerate face
+	const Pack one = set1(1.0f);
+	const Pack s0 = w00;
+	const Pack d0 = one / s0;
+	const Pack s1 = w11 - w01 * w01 * d0;
+	const Pack d1 = one / s1;
+	const Pack s2 = w22 - w12 * w12 * d1;
+	const Pack d2 = one / s2;
+	const Mask solvable = both(both(greaterThan(s0, zero), greaterThan(s1, zero)), greaterThan(s2, zero));
+	Pack x0 = m0 * d0;
+	Pack x1 = (m1 - w01 * x0) * d1;
+	const Pack x2 = (m2 - w12 * x1) * d2;
+	x1 = x1 - w12 * x2 * d1;
+	x0 = x0 - w01 * x1 * d0;
+
+	//rotate every corner's vertex frame into the face plane and re-express the tensor in it
+	const V3 faceNormal = cross(t, b);
+	const Pack minusOne = set1(-1.0f);
+	alignas(64) Scalar out[3][width];
+	for (int j = 0; j < 3; j++) {
+		const V3 u = gatherV3(soa.u1x.data(), soa.u1y.data(), soa.u1z.data(), vertex[j]);
+		const V3 v = gatherV3(soa.u2x.data(), soa.u2y.data(), soa.u2z.data(), vertex[j]);
+		const Pack pointArea = gather(soa.pointArea.data(), vertex[j]);
+		const V3 vertexNormal = cross(u, v);
+		const Pack ndot = dot(vertexNormal, faceNormal);
+		const V3 perpendicular = faceNormal - vertexNormal * ndot;
+		const V3 difference = (vertexNormal + faceNormal) * (one / (one + ndot));
+		const Mask flipped = lessEqual(ndot, minusOne);
+		const V3 flippedU = { zero - u.x, zero - u.y, zero - u.z };
+		const V3 flippedV = { zero - v.x, zero - v.y, zero - v.z };
+		const V3 ru = select(flipped, flippedU, u - difference * dot(u, perpendicular));
+		const V3 rv = select(flipped, flippedV, v - difference * dot(v, perpendicular));
+		const Pack u1 = dot(ru, t), v1 = dot(ru, b), u2 = dot(rv, t), v2 = dot(rv, b);
+		const Pack two = set1(2.0f);
+		const Pack c1 = x0 * u1 * u1 + x1 * (two * u1 * v1) + x2 * v1 * v1;
+		const Pack c12 = x0 * u1 * u2 + x1 * (u1 * v2 + u2 * v1) + x2 * v1 * v2;
+		const Pack c2 = x0 * u2 * u2 + x1 * (two * u2 * v2) + x2 * v2 * v2;
+		const Mask valid = both(solvable, greaterThan(pointArea, zero));
+		const Pack weight = select(valid, load(corner[j]) / pointArea, zero);
+		store(out[0], select(valid, weight * c1, zero));
+		store(out[1], select(valid, weight * c12, zero));
+		store(out[2], select(valid, weight * c2, zero));
+		for (int l = 0; l < width; l++) {
+			cornerCurv1[3 * (first + l) + j] = out[0][l];
+			cornerCurv12[3 * (first + l) + j] = out[1][l];
+			cornerCurv2[3 * (first + l) + j] = out[2][l];
+		}
+	}
+}
+
+//Faces [begin, end), whole packs here and the remainder one lane at a time.
+inline void perFaceCurvatures(const BasicCurvatureVertexSoA<Scalar>& soa, const unsigned int* indices, const Scalar* cornerAreas, size_t begin, size_t end,
+	Scalar* cornerCurv1, Scalar* cornerCurv12, Scalar* cornerCurv2) {
+	size_t f = begin;
+	for (; f + width <= end; f += width) perFaceLanes(soa, indices, cornerAreas, f, cornerCurv1, cornerCurv12, cornerCurv2);
+	if (f < end) tail::perFaceCurvatures(soa, indices, cornerAreas, f, end, cornerCurv1, cornerCurv12, cornerCurv2);
+}
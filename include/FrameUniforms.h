@@ -0,0 +1,142 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+//Constants shared by every program : std140 uniform blocks written once per frame (FrameConstants, binding 0) and
+//once per model drawn (DrawConstants, binding 1), instead of glGetUniformLocation / glUniform* for every uniform
+//of every program.
+//The blocks live in a persistently mapped buffer split into one slot per frame in flight, each slot holding the
+//frame's constants then up to drawsPerFrame draws' constants, bound with glBindBufferRange. A slot is only written
+//again once the fence of the frame that last read it has signaled. Without GL 4.4 buffer storage, or if the mapping
+//fails, it's a plain buffer updated with glNamedBufferSubData() instead.
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glad/glad.h>
+
+const GLuint frameUniformBinding = 0;
+const GLuint drawUniformBinding = 1;
+
+//Same layouts as the blocks in shaders/frameConstants.glsl (std140 : vec3s are stored as vec4s, blocks are padded
+//to a multiple of 16 bytes).
+struct FrameConstants {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 viewPosition; //camera in world space
+	glm::vec4 lightPosition;
+	glm::vec4 lineColor;
+	glm::vec4 backgroundColor;
+	GLuint drawFaded; //bools are 4 bytes in std140
+	GLuint cull;
+	GLuint padding[2];
+};
+static_assert(sizeof(FrameConstants) == 2 * 64 + 4 * 16 + 16, "FrameConstants doesn't match the std140 block");
+//Everything that depends on the model drawn.
+struct DrawConstants {
+	glm::mat4 model;
+	glm::vec4 objectViewPosition; //camera in the model's object space, Model::objectViewPosition()
+	float threshold; //apparent ridge threshold
+	float PDMagnitude; //principal direction arrow length
+	float padding[2];
+};
+static_assert(sizeof(DrawConstants) == 64 + 16 + 16, "DrawConstants doesn't match the std140 block");
+
+class FrameUniformBuffer {
+public:
+	const size_t slotCount;
+	const size_t drawsPerFrame;
+
+	//Needs the GL context current. Persistently mapped with GL 4.4 (glBufferStorage).
+	FrameUniformBuffer(size_t slotCount = 3, size_t drawsPerFrame = 16) : slotCount(slotCount), drawsPerFrame(drawsPerFrame), fences(slotCount, nullptr) {
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		entryBytes = (std::max(sizeof(FrameConstants), sizeof(DrawConstants)) + alignment - 1) / alignment * alignment;
+		slotBytes = entryBytes * (1 + drawsPerFrame);
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		if (GLAD_GL_VERSION_4_4) {
+			glBufferStorage(GL_UNIFORM_BUFFER, slotBytes * slotCount, nullptr, flags);
+			mapped = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, slotBytes * slotCount, flags));
+		}
+		if (!mapped) {
+			//storage is immutable once glBufferStorage() succeeded, so start over with a new buffer
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+			glBufferData(GL_UNIFORM_BUFFER, 2 * entryBytes, nullptr, GL_DYNAMIC_DRAW);
+			std::cout << "Frame constants : no persistently mapped buffer, updating a single buffer instead.\n";
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	FrameUniformBuffer(const FrameUniformBuffer&) = delete;
+	FrameUniformBuffer& operator=(const FrameUniformBuffer&) = delete;
+	bool isMapped() const { return mapped != nullptr; }
+
+	//Writes the frame's constants and binds them to frameUniformBinding, before the first draw / dispatch of the frame.
+	//Mapped : moves to the next slot, waiting for the GPU to be done with it.
+	void begin(const FrameConstants& constants) {
+		draws = 0;
+		if (!mapped) {
+			//GL orders the update after the draws already issued reading the previous contents
+			glNamedBufferSubData(buffer, 0, sizeof(FrameConstants), &constants);
+			glBindBufferRange(GL_UNIFORM_BUFFER, frameUniformBinding, buffer, 0, sizeof(FrameConstants));
+			return;
+		}
+		slot = (slot + 1) % slotCount;
+		if (fences[slot]) {
+			//The slot is only handed out once its fence has signaled : keep waiting past the timeout (a long frame
+			//isn't an error), and if the wait itself fails, glFinish() so nothing still reads the slot.
+			GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+			GLenum status;
+			while ((status = glClientWaitSync(fences[slot], flags, GLuint64(1000000000))) == GL_TIMEOUT_EXPIRED) flags = 0; //1s
+			if (status == GL_WAIT_FAILED) glFinish();
+			glDeleteSync(fences[slot]);
+			fences[slot] = nullptr;
+		}
+		std::memcpy(mapped + slot * slotBytes, &constants, sizeof(FrameConstants));
+		glBindBufferRange(GL_UNIFORM_BUFFER, frameUniformBinding, buffer, slot * slotBytes, sizeof(FrameConstants));
+	}
+	//Writes one model's constants into the next entry of the frame's slot and binds them to drawUniformBinding,
+	//before that model's draws / dispatches. Every entry stays untouched until the slot's fence signals.
+	void draw(const DrawConstants& constants) {
+		if (!mapped) {
+			glNamedBufferSubData(buffer, entryBytes, sizeof(DrawConstants), &constants);
+			glBindBufferRange(GL_UNIFORM_BUFFER, drawUniformBinding, buffer, entryBytes, sizeof(DrawConstants));
+			return;
+		}
+		if (draws == drawsPerFrame) {
+			//out of entries : wait for every draw of the slot so far instead of overwriting one still read
+			glFinish();
+			draws = 0;
+		}
+		const size_t offset = slot * slotBytes + (1 + draws) * entryBytes;
+		draws++;
+		std::memcpy(mapped + offset, &constants, sizeof(DrawConstants));
+		glBindBufferRange(GL_UNIFORM_BUFFER, drawUniformBinding, buffer, offset, sizeof(DrawConstants));
+	}
+	//After the last draw / dispatch of the frame.
+	void end() {
+		if (mapped) fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+private:
+	GLuint buffer = 0;
+	unsigned char* mapped = nullptr;
+	size_t entryBytes = 0;
+	size_t slotBytes = 0;
+	size_t slot = 0;
+	size_t draws = 0;
+	std::vector<GLsync> fences;
+};
+
+//Shared by the render loop and the startup benchmarks. Created on first use, so the GL context must be current.
+//Never destroyed, like stagingRing().
+inline FrameUniformBuffer& frameUniforms() {
+	static FrameUniformBuffer* uniforms = new FrameUniformBuffer();
+	return *uniforms;
+}
+
+#endif
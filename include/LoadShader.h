@@ -5,9 +5,38 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
 
 using std::cout;
 
+//Shaders with a "#pragma frameConstants" line get the FrameConstants / DrawConstants blocks (FrameUniforms.h),
+//declared once in frameConstantsPath, inserted right after their #version / #extension lines. The pragma line is
+//blanked and a #line directive follows the blocks, so compile errors still point at the shader's own lines.
+const char* const frameConstantsPath = ".\\shaders\\frameConstants.glsl";
+std::string insertFrameConstants(const std::string& code) {
+    const std::string marker = "#pragma frameConstants";
+    const size_t at = code.find(marker);
+    if (at == std::string::npos) return code;
+    static const std::string block = [] {
+        std::ifstream file(frameConstantsPath);
+        if (!file) std::cout << "Shader include : " << frameConstantsPath << " failed to read.\n";
+        std::stringstream stream;
+        stream << file.rdbuf();
+        return stream.str();
+    }();
+    std::string result = code;
+    result.erase(at, std::min(result.find('\n', at), result.size()) - at);
+    //after the #version line and any #extension lines following it
+    size_t insertAt = result.find("#version");
+    insertAt = (insertAt == std::string::npos) ? 0 : result.find('\n', insertAt);
+    while (insertAt != std::string::npos && result.compare(insertAt + 1, 10, "#extension") == 0) insertAt = result.find('\n', insertAt + 1);
+    if (insertAt == std::string::npos) return result;
+    insertAt++;
+    const size_t nextLine = std::count(result.begin(), result.begin() + insertAt, '\n') + 1;
+    result.insert(insertAt, block + "\n#line " + std::to_string(nextLine) + "\n");
+    return result;
+}
+
 GLuint loadShader(const GLchar* vertexPath, const GLchar* fragmentPath) {
     GLuint program;
     std::string vertexCode, fragmentCode;
@@ -23,8 +52,8 @@ GLuint loadShader(const GLchar* vertexPath, const GLchar* fragmentPath) {
         fragmentShaderStream << fragmentShaderFile.rdbuf();
         vertexShaderFile.close();
         fragmentShaderFile.close();
-        vertexCode = vertexShaderStream.str();
-        fragmentCode = fragmentShaderStream.str();
+        vertexCode = insertFrameConstants(vertexShaderStream.str());
+        fragmentCode = insertFrameConstants(fragmentShaderStream.str());
     }
     catch (std::ifstream::failure e) {
         std::cout << "Shader failed to read\n";
@@ -95,9 +124,9 @@ GLuint loadShader(const GLchar* vertexPath, const GLchar* fragmentPath, const GL
         fragmentShaderFile.close();
         geometryShaderFile.close();
 
-        vertexCode = vertexShaderStream.str();
-        fragmentCode = fragmentShaderStream.str();
-        geometryCode = geometryShaderStream.str();
+        vertexCode = insertFrameConstants(vertexShaderStream.str());
+        fragmentCode = insertFrameConstants(fragmentShaderStream.str());
+        geometryCode = insertFrameConstants(geometryShaderStream.str());
     }
     catch (std::ifstream::failure e) {
         //probably should spread this out for each shader, but whatever
@@ -175,7 +204,7 @@ GLuint loadComputeShader(const GLchar* computeShaderPath) {
         //stream from file
         shaderStream << file.rdbuf();
         file.close();
-        code = shaderStream.str(); //to string
+        code = insertFrameConstants(shaderStream.str()); //to string, with the shared blocks
     }
     catch (std::ifstream::failure e) {
         std::cout << "Compute shader failed to read!\n";
@@ -0,0 +1,273 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+//Binary cache of everything Model computes at load time that only depends on the source file.
+//One cache file sits next to each model (<model path>.arcache).
+//Sections are 64 byte aligned and stored in the same layout the SSBOs use (vec4 positions / normals etc.)
+//so a mapped cache can be handed straight to glBufferData without repacking.
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//Read only memory mapping of a whole file.
+//Move only, the mapping is released on destruction.
+class MappedFile {
+public:
+	MappedFile() {}
+	MappedFile(const std::string& path) { this->open(path); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept { this->moveFrom(other); }
+	MappedFile& operator=(MappedFile&& other) noexcept {
+		if (this != &other) { this->close(); this->moveFrom(other); }
+		return *this;
+	}
+	~MappedFile() { this->close(); }
+
+	bool open(const std::string& path) {
+		this->close();
+#ifdef _WIN32
+		fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (fileHandle == INVALID_HANDLE_VALUE) { fileHandle = NULL; return false; }
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) { this->close(); return false; }
+		mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mappingHandle == NULL) { this->close(); return false; }
+		mappedData = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (mappedData == NULL) { this->close(); return false; }
+		mappedSize = size_t(fileSize.QuadPart);
+#else
+		fileDescriptor = ::open(path.c_str(), O_RDONLY);
+		if (fileDescriptor < 0) return false;
+		struct stat fileStat;
+		if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0) { this->close(); return false; }
+		void* ptr = mmap(NULL, size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+		if (ptr == MAP_FAILED) { this->close(); return false; }
+		mappedData = ptr;
+		mappedSize = size_t(fileStat.st_size);
+#endif
+		return true;
+	}
+	void close() {
+#ifdef _WIN32
+		if (mappedData) UnmapViewOfFile(mappedData);
+		if (mappingHandle) CloseHandle(mappingHandle);
+		if (fileHandle) CloseHandle(fileHandle);
+		mappingHandle = NULL; fileHandle = NULL;
+#else
+		if (mappedData) munmap(mappedData, mappedSize);
+		if (fileDescriptor >= 0) ::close(fileDescriptor);
+		fileDescriptor = -1;
+#endif
+		mappedData = nullptr;
+		mappedSize = 0;
+	}
+	bool isOpen() const { return mappedData != nullptr; }
+	const unsigned char* data() const { return static_cast<const unsigned char*>(mappedData); }
+	size_t size() const { return mappedSize; }
+
+private:
+	void moveFrom(MappedFile& other) {
+		mappedData = other.mappedData; mappedSize = other.mappedSize;
+		other.mappedData = nullptr; other.mappedSize = 0;
+#ifdef _WIN32
+		fileHandle = other.fileHandle; mappingHandle = other.mappingHandle;
+		other.fileHandle = NULL; other.mappingHandle = NULL;
+#else
+		fileDescriptor = other.fileDescriptor;
+		other.fileDescriptor = -1;
+#endif
+	}
+	void* mappedData = nullptr;
+	size_t mappedSize = 0;
+#ifdef _WIN32
+	HANDLE fileHandle = NULL;
+	HANDLE mappingHandle = NULL;
+#else
+	int fileDescriptor = -1;
+#endif
+};
+
+//64 bit FNV-1a, folded 8 bytes at a time so hashing a large scan stays close to memory bandwidth.
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull) {
+	const uint64_t prime = 1099511628211ull;
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	uint64_t hash = seed;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, bytes + i, 8);
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+	for (; i < size; i++) {
+		hash = (hash ^ bytes[i]) * prime;
+	}
+	return hash;
+}
+
+//Content hash of a file. Returns 0 if the file can't be read.
+inline uint64_t hashFile(const std::string& path) {
+	MappedFile file(path);
+	if (!file.isOpen()) return 0;
+	return hashBytes(file.data(), file.size());
+}
+
+enum MeshCacheSectionID : uint32_t {
+	CACHE_POSITIONS = 0,      //vec4 per vertex
+	CACHE_NORMALS = 1,        //vec4 per vertex
+	CACHE_INDICES = 2,        //uint per index
+	CACHE_POINT_AREAS = 3,    //float per vertex
+	CACHE_CORNER_AREAS = 4,   //float per index
+	CACHE_PDS = 5,            //vec4 per vertex * 2 (max PDs then min PDs)
+	CACHE_CURVATURES = 6,     //float per vertex * 2 (max then min)
+	CACHE_CORNER_OFFSETS = 7, //uint per vertex + 1, start of every vertex's corner list
+	CACHE_SUBMESHES = 8,      //(first index, index count) per source mesh
+	CACHE_VERTEX_CORNERS = 9, //uint per index, corners sorted by vertex
+	CACHE_DCURVS = 10,        //vec4 per vertex, curvature derivatives
+	CACHE_SECTION_COUNT
+};
+
+struct MeshCacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t importFlags;
+	uint64_t sourceHash;
+	uint64_t sourceSize;
+	uint32_t numVertices;
+	uint32_t numIndices;
+	uint32_t sectionCount;
+	uint32_t reserved;
+};
+struct MeshCacheSection {
+	uint32_t id;
+	uint32_t reserved;
+	uint64_t offset; //from start of file
+	uint64_t bytes;
+};
+
+//Bump whenever the layout or meaning of any section changes.
+//2 : Assimp imports merge every mesh instead of only the first one.
+//3 : adjacent faces are vertex -> corner lists (CACHE_CORNER_OFFSETS / CACHE_VERTEX_CORNERS) instead of int[20] per vertex.
+//4 : curvature derivatives (CACHE_DCURVS).
+//5 : per vertex curvature sums gathered over the vertex -> corner lists, summed in a different order than the scatter.
+const uint32_t meshCacheVersion = 5;
+const size_t meshCacheAlignment = 64;
+const char meshCacheMagic[8] = { 'A','R','C','A','C','H','E','\0' };
+
+inline std::string meshCachePath(const std::string& modelPath) {
+	return modelPath + ".arcache";
+}
+
+//Mapped, validated cache file.
+class MeshCache {
+public:
+	MeshCacheHeader header;
+
+	//Maps the cache and checks it was built from this exact source content with these import flags.
+	bool open(const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize, uint32_t importFlags) {
+		if (!file.open(cachePath)) return false;
+		if (file.size() < sizeof(MeshCacheHeader)) { file.close(); return false; }
+		std::memcpy(&header, file.data(), sizeof(MeshCacheHeader));
+		if (std::memcmp(header.magic, meshCacheMagic, 8) != 0 || header.version != meshCacheVersion
+			|| header.sourceHash != sourceHash || header.sourceSize != sourceSize || header.importFlags != importFlags) {
+			file.close();
+			return false;
+		}
+		size_t tableEnd = sizeof(MeshCacheHeader) + header.sectionCount * sizeof(MeshCacheSection);
+		if (tableEnd > file.size()) { file.close(); return false; }
+		const MeshCacheSection* table = reinterpret_cast<const MeshCacheSection*>(file.data() + sizeof(MeshCacheHeader));
+		sections.assign(table, table + header.sectionCount);
+		for (const MeshCacheSection& s : sections) {
+			if (s.offset + s.bytes > file.size()) { file.close(); return false; }
+		}
+		return true;
+	}
+	//Pointer into the mapping, nullptr if the section is missing or has an unexpected size.
+	const void* section(MeshCacheSectionID id, size_t expectedBytes) const {
+		for (const MeshCacheSection& s : sections) {
+			if (s.id == id) return (s.bytes == expectedBytes) ? file.data() + s.offset : nullptr;
+		}
+		return nullptr;
+	}
+	//Size of a section as stored, 0 if it's missing.
+	size_t sectionBytes(MeshCacheSectionID id) const {
+		for (const MeshCacheSection& s : sections) if (s.id == id) return size_t(s.bytes);
+		return 0;
+	}
+	void close() { file.close(); sections.clear(); }
+
+private:
+	MappedFile file;
+	std::vector<MeshCacheSection> sections;
+};
+
+//A section to be written : id, pointer and byte size of the data.
+struct MeshCacheBlob {
+	MeshCacheSectionID id;
+	const void* data;
+	size_t bytes;
+};
+
+//Writes to a temporary file first and renames, so a crash never leaves a half written cache behind.
+inline bool writeMeshCache(const std::string& cachePath, uint64_t sourceHash, uint64_t sourceSize, uint32_t importFlags,
+	uint32_t numVertices, uint32_t numIndices, const std::vector<MeshCacheBlob>& blobs) {
+	MeshCacheHeader header = {};
+	std::memcpy(header.magic, meshCacheMagic, 8);
+	header.version = meshCacheVersion;
+	header.importFlags = importFlags;
+	header.sourceHash = sourceHash;
+	header.sourceSize = sourceSize;
+	header.numVertices = numVertices;
+	header.numIndices = numIndices;
+	header.sectionCount = uint32_t(blobs.size());
+
+	std::vector<MeshCacheSection> table(blobs.size());
+	uint64_t offset = sizeof(MeshCacheHeader) + blobs.size() * sizeof(MeshCacheSection);
+	for (size_t i = 0; i < blobs.size(); i++) {
+		offset = (offset + meshCacheAlignment - 1) / meshCacheAlignment * meshCacheAlignment;
+		table[i].id = blobs[i].id;
+		table[i].reserved = 0;
+		table[i].offset = offset;
+		table[i].bytes = blobs[i].bytes;
+		offset += blobs[i].bytes;
+	}
+
+	std::string tmpPath = cachePath + ".tmp";
+	std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+	if (!out) return false;
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(MeshCacheSection));
+	uint64_t written = sizeof(MeshCacheHeader) + table.size() * sizeof(MeshCacheSection);
+	const char padding[meshCacheAlignment] = {};
+	for (size_t i = 0; i < blobs.size(); i++) {
+		out.write(padding, std::streamsize(table[i].offset - written));
+		out.write(static_cast<const char*>(blobs[i].data), std::streamsize(blobs[i].bytes));
+		written = table[i].offset + blobs[i].bytes;
+	}
+	out.close();
+	if (!out) { std::remove(tmpPath.c_str()); return false; }
+	std::remove(cachePath.c_str());
+	if (std::rename(tmpPath.c_str(), cachePath.c_str()) != 0) { std::remove(tmpPath.c_str()); return false; }
+	return true;
+}
+
+#endif
@@ -0,0 +1,757 @@
+#ifndef MESH_PROCESSING_H
+#define MESH_PROCESSING_H
+//CPU side processing shared by the native loaders : everything here works on plain
+//position / normal / triangle index arrays and makes no GL calls.
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "ThreadPool.h"
+
+//Draw range of one source mesh inside the merged index buffer.
+//Indices are already offset into the merged vertex array, so compute passes can treat the model as one mesh.
+struct SubMesh {
+	unsigned int firstIndex;
+	unsigned int indexCount;
+};
+
+//Optional receiver for a loader's output as it's produced, so it can be streamed out while parsing continues.
+//sizes() is called once with the final array lengths before anything else. positions / normals / indices then get
+//ranges of the output arrays once those ranges are final, from any pool thread and in any order.
+struct MeshStreamSink {
+	std::function<void(size_t vertexCount, size_t indexCount)> sizes;
+	std::function<void(const glm::vec3* data, size_t first, size_t count)> positions;
+	std::function<void(const glm::vec3* data, size_t first, size_t count)> normals;
+	std::function<void(const unsigned int* data, size_t first, size_t count)> indices;
+};
+
+//Exclusive prefix sum of per chunk counts, so every chunk knows where its output starts.
+inline std::vector<size_t> chunkOffsets(const std::vector<size_t>& counts) {
+	std::vector<size_t> offsets(counts.size() + 1, 0);
+	for (size_t i = 0; i < counts.size(); i++) offsets[i + 1] = offsets[i] + counts[i];
+	return offsets;
+}
+//Splits [0, count) into roughly equal chunks for parallelFor, a few per worker.
+inline size_t chunkCountFor(size_t count, size_t minChunk = 1 << 14) {
+	return std::max<size_t>(1, std::min(globalThreadPool().size() * 4, count / minChunk));
+}
+
+//64 bit mix of a grid cell, used as the weld hash key.
+inline uint64_t weldCellKey(int64_t x, int64_t y, int64_t z) {
+	uint64_t h = uint64_t(x) * 0x9E3779B97F4A7C15ull ^ uint64_t(y) * 0xC2B2AE3D27D4EB4Full ^ uint64_t(z) * 0x165667B19E3779F9ull;
+	h ^= h >> 31; h *= 0xff51afd7ed558ccdull; h ^= h >> 33;
+	return h;
+}
+//Exact welds hash the float bits instead of a cell (-0 and +0 are the same position).
+inline uint64_t weldExactKey(const glm::vec3& p) {
+	uint32_t bits[3];
+	for (int k = 0; k < 3; k++) { float v = (p[k] == 0.0f) ? 0.0f : p[k]; std::memcpy(&bits[k], &v, 4); }
+	return weldCellKey(bits[0], bits[1], bits[2]);
+}
+
+//Merges vertices closer than epsilon (0 : exactly equal positions), replacing aiProcess_JoinIdenticalVertices.
+//Positions are hashed into a grid of epsilon sized cells, the (key, vertex) pairs are bucketed with a parallel
+//counting sort and every vertex searches its 27 neighbouring cells for the lowest index within epsilon.
+//Following those links to the end (pointer jumping) gives each cluster one representative, the lowest index in it.
+//Representatives keep their position and uv, normals are averaged over the cluster.
+//Indices are remapped, triangles that collapsed are dropped and the submesh ranges are fixed up.
+//Returns the number of vertices merged away.
+inline size_t weldVertices(std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals, std::vector<glm::vec2>* uvs,
+	std::vector<unsigned int>& indices, std::vector<SubMesh>* subMeshes, float epsilon) {
+	ThreadPool& pool = globalThreadPool();
+	const size_t n = vertices.size();
+	if (n < 2) return 0;
+	const bool exact = !(epsilon > 0.0f);
+	const float inverseCell = exact ? 0.0f : 1.0f / epsilon;
+	const float epsilon2 = epsilon * epsilon;
+	auto cellOf = [&](const glm::vec3& p, int64_t cell[3]) {
+		for (int k = 0; k < 3; k++) cell[k] = int64_t(std::floor(p[k] * inverseCell));
+	};
+
+	//(key, vertex) pairs bucketed by the key's top bits with a parallel counting sort, then each bucket sorted
+	struct Entry { uint64_t key; uint32_t vertex; };
+	const int bucketBits = 12;
+	const size_t bucketCount = size_t(1) << bucketBits;
+	std::vector<uint64_t> keys(n);
+	const size_t chunks = chunkCountFor(n);
+	std::vector<std::vector<size_t>> histograms(chunks, std::vector<size_t>(bucketCount, 0));
+	pool.parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) {
+			for (size_t i = n * c / chunks; i < n * (c + 1) / chunks; i++) {
+				int64_t cell[3];
+				cellOf(vertices[i], cell);
+				keys[i] = exact ? weldExactKey(vertices[i]) : weldCellKey(cell[0], cell[1], cell[2]);
+				histograms[c][keys[i] >> (64 - bucketBits)]++;
+			}
+		}
+	});
+	std::vector<size_t> bucketStart(bucketCount + 1, 0);
+	{
+		size_t running = 0;
+		for (size_t b = 0; b < bucketCount; b++) {
+			bucketStart[b] = running;
+			for (size_t c = 0; c < chunks; c++) { size_t count = histograms[c][b]; histograms[c][b] = running; running += count; }
+		}
+		bucketStart[bucketCount] = running;
+	}
+	std::vector<Entry> entries(n);
+	pool.parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) {
+			for (size_t i = n * c / chunks; i < n * (c + 1) / chunks; i++) entries[histograms[c][keys[i] >> (64 - bucketBits)]++] = { keys[i], uint32_t(i) };
+		}
+	});
+	std::vector<std::vector<size_t>>().swap(histograms);
+	std::vector<uint64_t>().swap(keys);
+	pool.parallelFor(0, bucketCount, 64, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++) {
+			std::sort(entries.begin() + bucketStart[b], entries.begin() + bucketStart[b + 1],
+				[](const Entry& l, const Entry& r) { return l.key < r.key || (l.key == r.key && l.vertex < r.vertex); });
+		}
+	});
+
+	//lowest index within epsilon, searching the neighbouring cells
+	std::vector<uint32_t> representative(n);
+	pool.parallelFor(0, n, 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const glm::vec3 p = vertices[i];
+			uint32_t best = uint32_t(i);
+			int64_t cell[3];
+			cellOf(p, cell);
+			const int reach = exact ? 0 : 1;
+			for (int dx = -reach; dx <= reach; dx++) for (int dy = -reach; dy <= reach; dy++) for (int dz = -reach; dz <= reach; dz++) {
+				const uint64_t key = exact ? weldExactKey(p) : weldCellKey(cell[0] + dx, cell[1] + dy, cell[2] + dz);
+				const size_t b = size_t(key >> (64 - bucketBits));
+				auto first = std::lower_bound(entries.begin() + bucketStart[b], entries.begin() + bucketStart[b + 1], key,
+					[](const Entry& e, uint64_t k) { return e.key < k; });
+				for (auto it = first; it != entries.begin() + bucketStart[b + 1] && it->key == key && it->vertex < best; ++it) {
+					const glm::vec3 d = vertices[it->vertex] - p;
+					if (exact ? (vertices[it->vertex] == p) : (glm::dot(d, d) <= epsilon2)) best = it->vertex;
+				}
+			}
+			representative[i] = best;
+		}
+	});
+	std::vector<Entry>().swap(entries);
+	//pointer jumping : representative[i] <= i, so this settles on the lowest index of each chain
+	std::vector<uint32_t> next(n);
+	std::atomic<bool> changed{ true };
+	while (changed) {
+		changed = false;
+		pool.parallelFor(0, n, 1 << 16, [&](size_t begin, size_t end) {
+			bool local = false;
+			for (size_t i = begin; i < end; i++) {
+				next[i] = representative[representative[i]];
+				local |= (next[i] != representative[i]);
+			}
+			if (local) changed = true;
+		});
+		representative.swap(next);
+	}
+
+	//compact : new index of every representative from a prefix sum over chunk counts
+	std::vector<size_t> keptPerChunk(chunks, 0);
+	pool.parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++)
+			for (size_t i = n * c / chunks; i < n * (c + 1) / chunks; i++) keptPerChunk[c] += (representative[i] == i);
+	});
+	const std::vector<size_t> keptOffset = chunkOffsets(keptPerChunk);
+	const size_t kept = keptOffset[chunks];
+	if (kept == n) return 0;
+	std::vector<uint32_t> newIndex(n);
+	std::vector<glm::vec3> newVertices(kept), newNormals(kept, glm::vec3(0.0f));
+	std::vector<glm::vec2> newUVs(uvs && uvs->size() == n ? kept : 0);
+	pool.parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) {
+			size_t out = keptOffset[c];
+			for (size_t i = n * c / chunks; i < n * (c + 1) / chunks; i++) {
+				if (representative[i] != i) continue;
+				newIndex[i] = uint32_t(out);
+				newVertices[out] = vertices[i];
+				if (!newUVs.empty()) newUVs[out] = (*uvs)[i];
+				out++;
+			}
+		}
+	});
+	pool.parallelFor(0, n, 1 << 16, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) if (representative[i] != i) newIndex[i] = newIndex[representative[i]];
+	});
+	//scattered sum over the cluster, kept serial : several vertices write the same output
+	if (normals.size() == n) {
+		for (size_t i = 0; i < n; i++) newNormals[newIndex[i]] += normals[i];
+		for (glm::vec3& v : newNormals) { float len = glm::length(v); v = (len > 0.0f) ? v / len : glm::vec3(0.0f, 0.0f, 1.0f); }
+	}
+
+	//remap triangles, dropping the ones that collapsed
+	const size_t triangles = indices.size() / 3;
+	const size_t triangleChunks = chunkCountFor(triangles);
+	std::vector<size_t> keptTrianglesPerChunk(triangleChunks, 0);
+	std::vector<unsigned char> keepTriangle(triangles);
+	pool.parallelFor(0, triangleChunks, 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) {
+			for (size_t t = triangles * c / triangleChunks; t < triangles * (c + 1) / triangleChunks; t++) {
+				for (int k = 0; k < 3; k++) indices[3 * t + k] = newIndex[indices[3 * t + k]];
+				keepTriangle[t] = indices[3 * t] != indices[3 * t + 1] && indices[3 * t + 1] != indices[3 * t + 2] && indices[3 * t] != indices[3 * t + 2];
+				keptTrianglesPerChunk[c] += keepTriangle[t];
+			}
+		}
+	});
+	const std::vector<size_t> triangleOffset = chunkOffsets(keptTrianglesPerChunk);
+	std::vector<unsigned int> newIndices(3 * triangleOffset[triangleChunks]);
+	//kept triangles before each old triangle, for fixing up the submesh ranges
+	std::vector<size_t> keptBefore(triangles + 1, 0);
+	pool.parallelFor(0, triangleChunks, 1, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) {
+			size_t out = triangleOffset[c];
+			for (size_t t = triangles * c / triangleChunks; t < triangles * (c + 1) / triangleChunks; t++) {
+				keptBefore[t] = out;
+				if (!keepTriangle[t]) continue;
+				for (int k = 0; k < 3; k++) newIndices[3 * out + k] = indices[3 * t + k];
+				out++;
+			}
+		}
+	});
+	keptBefore[triangles] = triangleOffset[triangleChunks];
+	if (subMeshes) {
+		for (SubMesh& subMesh : *subMeshes) {
+			size_t first = keptBefore[subMesh.firstIndex / 3], last = keptBefore[(subMesh.firstIndex + subMesh.indexCount) / 3];
+			subMesh.firstIndex = static_cast<unsigned int>(3 * first);
+			subMesh.indexCount = static_cast<unsigned int>(3 * (last - first));
+		}
+	}
+
+	vertices.swap(newVertices);
+	if (normals.size() == n) normals.swap(newNormals);
+	if (!newUVs.empty()) uvs->swap(newUVs);
+	indices.swap(newIndices);
+	return n - kept;
+}
+
+//Vertex -> corner incidence in compressed sparse row form : the corners (positions in the index buffer) using
+//vertex v are corners[offsets[v] .. offsets[v + 1]), in increasing order, so sums gathered over them
+//always add in the same order. corner / 3 is the face, corner % 3 the vertex's place in it.
+struct VertexCorners {
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> corners;
+};
+//Counting sort : count every vertex's corners, prefix sum into offsets, scatter, then sort each (short) list.
+inline void buildVertexCorners(const std::vector<unsigned int>& indices, size_t vertexCount, VertexCorners& out) {
+	ThreadPool& pool = globalThreadPool();
+	const size_t cornerCount = indices.size() - indices.size() % 3;
+	std::vector<std::atomic<uint32_t>> cursor(vertexCount);
+	pool.parallelFor(0, vertexCount, 1 << 16, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) cursor[v].store(0, std::memory_order_relaxed);
+	});
+	pool.parallelFor(0, cornerCount, 1 << 16, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) cursor[indices[c]].fetch_add(1, std::memory_order_relaxed);
+	});
+	//prefix sum : per chunk totals first, then every chunk runs from its own base
+	out.offsets.resize(vertexCount + 1);
+	const size_t chunks = chunkCountFor(vertexCount);
+	std::vector<size_t> chunkTotals(chunks, 0);
+	pool.parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; k++)
+			for (size_t v = vertexCount * k / chunks; v < vertexCount * (k + 1) / chunks; v++) chunkTotals[k] += cursor[v].load(std::memory_order_relaxed);
+	});
+	const std::vector<size_t> chunkBase = chunkOffsets(chunkTotals);
+	pool.parallelFor(0, chunks, 1, [&](size_t begin, size_t end) {
+		for (size_t k = begin; k < end; k++) {
+			uint32_t running = uint32_t(chunkBase[k]);
+			for (size_t v = vertexCount * k / chunks; v < vertexCount * (k + 1) / chunks; v++) {
+				out.offsets[v] = running;
+				running += cursor[v].load(std::memory_order_relaxed);
+				cursor[v].store(out.offsets[v], std::memory_order_relaxed);
+			}
+		}
+	});
+	out.offsets[vertexCount] = uint32_t(cornerCount);
+	out.corners.resize(cornerCount);
+	pool.parallelFor(0, cornerCount, 1 << 16, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) out.corners[cursor[indices[c]].fetch_add(1, std::memory_order_relaxed)] = uint32_t(c);
+	});
+	pool.parallelFor(0, vertexCount, 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) std::sort(out.corners.begin() + out.offsets[v], out.corners.begin() + out.offsets[v + 1]);
+	});
+}
+
+//Unique edges of the mesh : edge e runs from vertices[2e] to vertices[2e + 1] (lower index first),
+//faceEdges[3f + i] is the edge from corner i to corner (i + 1) % 3 of face f, noEdge if they're the same vertex.
+struct MeshEdges {
+	static const uint32_t noEdge = 0xFFFFFFFFu;
+	std::vector<uint32_t> vertices;
+	std::vector<uint32_t> faceEdges;
+	size_t size() const { return vertices.size() / 2; }
+};
+//Every edge belongs to its lower vertex, which numbers its edges in the order its (sorted) corners reach them,
+//so the numbering doesn't depend on the thread count. Count per vertex, prefix sum, write, then every face
+//looks its edges up in the short list of their lower vertex.
+inline void buildMeshEdges(const std::vector<unsigned int>& indices, const VertexCorners& corners, MeshEdges& out) {
+	ThreadPool& pool = globalThreadPool();
+	const size_t vertexCount = corners.offsets.size() - 1;
+	const size_t faceCount = corners.corners.size() / 3;
+	//higher neighbours of v, each once
+	auto higherNeighbours = [&](size_t v, std::vector<uint32_t>& neighbours) {
+		neighbours.clear();
+		for (uint32_t k = corners.offsets[v]; k < corners.offsets[v + 1]; k++) {
+			const uint32_t corner = corners.corners[k];
+			const uint32_t face = corner - corner % 3;
+			const uint32_t ends[2] = { indices[face + (corner + 1) % 3], indices[face + (corner + 2) % 3] };
+			for (uint32_t n : ends)
+				if (n > v && std::find(neighbours.begin(), neighbours.end(), n) == neighbours.end()) neighbours.push_back(n);
+		}
+	};
+	std::vector<uint32_t> edgeOffsets(vertexCount + 1, 0);
+	pool.parallelFor(0, vertexCount, 1 << 14, [&](size_t begin, size_t end) {
+		std::vector<uint32_t> neighbours;
+		for (size_t v = begin; v < end; v++) {
+			higherNeighbours(v, neighbours);
+			edgeOffsets[v + 1] = uint32_t(neighbours.size());
+		}
+	});
+	for (size_t v = 0; v < vertexCount; v++) edgeOffsets[v + 1] += edgeOffsets[v];
+	out.vertices.resize(size_t(edgeOffsets[vertexCount]) * 2);
+	pool.parallelFor(0, vertexCount, 1 << 14, [&](size_t begin, size_t end) {
+		std::vector<uint32_t> neighbours;
+		for (size_t v = begin; v < end; v++) {
+			higherNeighbours(v, neighbours);
+			for (size_t i = 0; i < neighbours.size(); i++) {
+				out.vertices[2 * (edgeOffsets[v] + i)] = uint32_t(v);
+				out.vertices[2 * (edgeOffsets[v] + i) + 1] = neighbours[i];
+			}
+		}
+	});
+	out.faceEdges.resize(faceCount * 3);
+	pool.parallelFor(0, faceCount, 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t f = begin; f < end; f++) {
+			for (size_t i = 0; i < 3; i++) {
+				const uint32_t a = indices[3 * f + i], b = indices[3 * f + (i + 1) % 3];
+				const uint32_t low = std::min(a, b), high = std::max(a, b);
+				uint32_t edge = MeshEdges::noEdge;
+				for (uint32_t e = edgeOffsets[low]; a != b && e < edgeOffsets[low + 1]; e++)
+					if (out.vertices[2 * e + 1] == high) { edge = e; break; }
+				out.faceEdges[3 * f + i] = edge;
+			}
+		}
+	});
+}
+
+//Runs of consecutive faces (the index buffer is already in cache / Morton order, so runs are compact patches)
+//for culling the per frame passes. Same layout as the Cluster struct of clusterCull.compute (std430).
+struct MeshCluster {
+	glm::vec4 sphere; //xyz : center, w : radius, bounds the cluster's vertices
+	glm::vec4 cone; //xyz : axis, w : largest angle (radians) between the axis and a vertex normal, pi if there's no axis
+	uint32_t firstFace, faceCount;
+	uint32_t firstVertex, vertexCount; //in MeshClusters::vertices
+};
+static_assert(sizeof(MeshCluster) == 48, "MeshCluster doesn't match the std430 struct");
+//vertices[firstVertex, firstVertex + vertexCount) of a cluster are the vertices of its faces, then their
+//neighbours that aren't in it : Dt1q1 at a vertex reads q1 of its one ring, so those need q1 too.
+struct MeshClusters {
+	std::vector<MeshCluster> clusters;
+	std::vector<uint32_t> vertices;
+	size_t facesPerCluster = 128; //cluster c starts at face c * facesPerCluster
+	size_t size() const { return clusters.size(); }
+};
+//Bounds of the cluster's faces from the current positions / normals, again after they change.
+inline void fitMeshCluster(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals, const std::vector<unsigned int>& indices,
+	MeshCluster& cluster) {
+	const size_t first = 3 * size_t(cluster.firstFace), last = first + 3 * size_t(cluster.faceCount);
+	//sphere around the box, cone around the normals
+	glm::vec3 low(vertices[indices[first]]), high(low), axis(0.0f);
+	for (size_t i = first; i < last; i++) {
+		low = glm::min(low, vertices[indices[i]]);
+		high = glm::max(high, vertices[indices[i]]);
+		axis += glm::normalize(normals[indices[i]]);
+	}
+	const glm::vec3 center = 0.5f * (low + high);
+	const float axisLength = glm::length(axis);
+	axis = (axisLength > 0.0f) ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+	float radius = 0.0f, angle = 0.0f;
+	for (size_t i = first; i < last; i++) {
+		radius = std::max(radius, glm::length(vertices[indices[i]] - center));
+		angle = std::max(angle, std::acos(glm::clamp(glm::dot(axis, glm::normalize(normals[indices[i]])), -1.0f, 1.0f)));
+	}
+	cluster.sphere = glm::vec4(center, radius);
+	cluster.cone = glm::vec4(axis, (axisLength > 0.0f) ? angle : 3.14159265f);
+}
+//Clusters of facesPerCluster faces, fitted and given their vertex lists in parallel, then packed in cluster order.
+inline void buildMeshClusters(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals, const std::vector<unsigned int>& indices,
+	const VertexCorners& corners, MeshClusters& out, size_t facesPerCluster = 128) {
+	ThreadPool& pool = globalThreadPool();
+	const size_t faceCount = indices.size() / 3;
+	const size_t clusterCount = (faceCount + facesPerCluster - 1) / facesPerCluster;
+	out.facesPerCluster = facesPerCluster;
+	out.clusters.resize(clusterCount);
+	std::vector<std::vector<uint32_t>> clusterVertices(clusterCount);
+	pool.parallelFor(0, clusterCount, 64, [&](size_t begin, size_t end) {
+		std::vector<uint32_t> ring;
+		for (size_t c = begin; c < end; c++) {
+			MeshCluster& cluster = out.clusters[c];
+			cluster.firstFace = uint32_t(c * facesPerCluster);
+			cluster.faceCount = uint32_t(std::min(facesPerCluster, faceCount - c * facesPerCluster));
+			fitMeshCluster(vertices, normals, indices, cluster);
+			std::vector<uint32_t>& own = clusterVertices[c];
+			own.assign(indices.begin() + 3 * size_t(cluster.firstFace), indices.begin() + 3 * size_t(cluster.firstFace + cluster.faceCount));
+			std::sort(own.begin(), own.end());
+			own.erase(std::unique(own.begin(), own.end()), own.end());
+			//one ring of the cluster's vertices, appended after them
+			ring.clear();
+			for (uint32_t v : own) {
+				for (uint32_t k = corners.offsets[v]; k < corners.offsets[v + 1]; k++) {
+					const uint32_t corner = corners.corners[k];
+					const uint32_t face = corner - corner % 3;
+					ring.push_back(indices[face + (corner + 1) % 3]);
+					ring.push_back(indices[face + (corner + 2) % 3]);
+				}
+			}
+			std::sort(ring.begin(), ring.end());
+			ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+			const size_t ownCount = own.size();
+			for (uint32_t v : ring)
+				if (!std::binary_search(own.begin(), own.begin() + ownCount, v)) own.push_back(v);
+		}
+	});
+	size_t vertexTotal = 0;
+	for (size_t c = 0; c < clusterCount; c++) {
+		out.clusters[c].firstVertex = uint32_t(vertexTotal);
+		out.clusters[c].vertexCount = uint32_t(clusterVertices[c].size());
+		vertexTotal += clusterVertices[c].size();
+	}
+	out.vertices.resize(vertexTotal);
+	pool.parallelFor(0, clusterCount, 64, [&](size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++)
+			std::copy(clusterVertices[c].begin(), clusterVertices[c].end(), out.vertices.begin() + out.clusters[c].firstVertex);
+	});
+}
+
+//How a face's normal is weighted in the normals of its vertices.
+enum NormalWeighting {
+	NORMALS_AREA,  //by the face's area
+	NORMALS_ANGLE  //by the face's angle at the vertex, doesn't depend on how the surface around it is triangulated
+};
+inline const char* normalWeightingName(NormalWeighting weighting) {
+	return weighting == NORMALS_ANGLE ? "angle" : "area";
+}
+//Smooth vertex normals from the faces. Per face (split over the thread pool) : the weighted face normal of every corner.
+//Per vertex : the sum over its corners in corner order, normalized, so results don't depend on the thread count.
+//Vertices without a non degenerate face get (0, 0, 1).
+//A face's normal weighted for each of its corners.
+inline void faceCornerNormals(const std::vector<glm::vec3>& vertices, const unsigned int* face, NormalWeighting weighting, glm::vec3 cornerNormals[3]) {
+	const glm::vec3 p[3] = { vertices[face[0]], vertices[face[1]], vertices[face[2]] };
+	//twice the area along the normal
+	const glm::vec3 faceNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+	const float length = glm::length(faceNormal);
+	for (int j = 0; j < 3; j++) {
+		glm::vec3 weighted = faceNormal;
+		if (weighting == NORMALS_ANGLE) {
+			const glm::vec3 a = p[(j + 1) % 3] - p[j], b = p[(j + 2) % 3] - p[j];
+			weighted = (length > 0.0f) ? faceNormal * (std::atan2(length, glm::dot(a, b)) / length) : glm::vec3(0.0f);
+		}
+		cornerNormals[j] = weighted;
+	}
+}
+//Sum of a vertex's corner normals, normalized. Corners are gathered in list order, so it's the same on every run.
+template<typename CornerNormal>
+inline glm::vec3 gatherVertexNormal(const VertexCorners& corners, size_t v, CornerNormal cornerNormal) {
+	glm::vec3 sum(0.0f);
+	for (uint32_t k = corners.offsets[v]; k < corners.offsets[v + 1]; k++) sum += cornerNormal(corners.corners[k]);
+	const float length = glm::length(sum);
+	return (length > 0.0f) ? sum / length : glm::vec3(0.0f, 0.0f, 1.0f);
+}
+inline void generateVertexNormals(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, const VertexCorners& corners,
+	std::vector<glm::vec3>& normals, NormalWeighting weighting = NORMALS_AREA) {
+	ThreadPool& pool = globalThreadPool();
+	const size_t faceCount = indices.size() / 3;
+	std::vector<glm::vec3> cornerNormals(3 * faceCount);
+	pool.parallelFor(0, faceCount, 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t f = begin; f < end; f++) faceCornerNormals(vertices, &indices[3 * f], weighting, &cornerNormals[3 * f]);
+	});
+	normals.resize(vertices.size());
+	pool.parallelFor(0, vertices.size(), 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) normals[v] = gatherVertexNormal(corners, v, [&](uint32_t corner) { return cornerNormals[corner]; });
+	});
+}
+//Same as generateVertexNormals() for the listed vertices only, after some positions moved : the list has to hold
+//every vertex sharing a face with a moved one. Gives the same normals as regenerating all of them.
+inline void regenerateVertexNormals(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, const VertexCorners& corners,
+	const std::vector<uint32_t>& list, std::vector<glm::vec3>& normals, NormalWeighting weighting = NORMALS_AREA) {
+	for (uint32_t v : list) {
+		normals[v] = gatherVertexNormal(corners, v, [&](uint32_t corner) {
+			glm::vec3 cornerNormals[3];
+			faceCornerNormals(vertices, &indices[corner - corner % 3], weighting, cornerNormals);
+			return cornerNormals[corner % 3];
+		});
+	}
+}
+inline void generateVertexNormals(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, std::vector<glm::vec3>& normals,
+	NormalWeighting weighting = NORMALS_AREA) {
+	VertexCorners corners;
+	buildVertexCorners(indices, vertices.size(), corners);
+	generateVertexNormals(vertices, indices, corners, normals, weighting);
+}
+
+//Vertices whose normal is still zero get generated ones (generateVertexNormals()),
+//then every normal is normalized. normals must already have one entry per vertex.
+inline void completeVertexNormals(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, std::vector<glm::vec3>& normals,
+	NormalWeighting weighting = NORMALS_AREA) {
+	bool missingNormals = false;
+	for (const glm::vec3& n : normals) if (glm::dot(n, n) == 0.0f) { missingNormals = true; break; }
+	if (missingNormals) {
+		std::vector<glm::vec3> generated;
+		generateVertexNormals(vertices, indices, generated, weighting);
+		for (size_t i = 0; i < normals.size(); i++) if (glm::dot(normals[i], normals[i]) == 0.0f) normals[i] = generated[i];
+	}
+	for (glm::vec3& n : normals) {
+		float len = glm::length(n);
+		n = (len > 0.0f) ? n / len : glm::vec3(0.0f, 0.0f, 1.0f);
+	}
+}
+
+//Faces around a set of vertices and vertices of a set of faces, for updating part of a mesh.
+//Membership is an epoch stamp per face / vertex, so nothing the size of the mesh is cleared per query.
+struct RingQuery {
+	std::vector<uint32_t> faceStamp;
+	std::vector<uint32_t> vertexStamp;
+	uint32_t epoch = 0;
+
+	//Faces using any of vertices, each once.
+	void facesAround(const VertexCorners& corners, const std::vector<uint32_t>& vertices, std::vector<uint32_t>& faces) {
+		const uint32_t stamp = this->nextEpoch(corners.corners.size() / 3, corners.offsets.size() - 1);
+		faces.clear();
+		for (uint32_t v : vertices) {
+			for (uint32_t k = corners.offsets[v]; k < corners.offsets[v + 1]; k++) {
+				const uint32_t f = corners.corners[k] / 3;
+				if (faceStamp[f] == stamp) continue;
+				faceStamp[f] = stamp;
+				faces.push_back(f);
+			}
+		}
+	}
+	//Vertices of faces, each once.
+	void verticesOf(const VertexCorners& corners, const std::vector<unsigned int>& indices, const std::vector<uint32_t>& faces, std::vector<uint32_t>& vertices) {
+		const uint32_t stamp = this->nextEpoch(corners.corners.size() / 3, corners.offsets.size() - 1);
+		vertices.clear();
+		for (uint32_t f : faces) {
+			for (int j = 0; j < 3; j++) {
+				const uint32_t v = indices[3 * size_t(f) + j];
+				if (vertexStamp[v] == stamp) continue;
+				vertexStamp[v] = stamp;
+				vertices.push_back(v);
+			}
+		}
+	}
+
+private:
+	uint32_t nextEpoch(size_t faceCount, size_t vertexCount) {
+		if (faceStamp.size() < faceCount) faceStamp.resize(faceCount, 0);
+		if (vertexStamp.size() < vertexCount) vertexStamp.resize(vertexCount, 0);
+		if (++epoch == 0) {
+			std::fill(faceStamp.begin(), faceStamp.end(), 0);
+			std::fill(vertexStamp.begin(), vertexStamp.end(), 0);
+			epoch = 1;
+		}
+		return epoch;
+	}
+};
+
+//Post transform cache size assumed by the triangle reordering and the statistics.
+const unsigned int vertexCacheSize = 16;
+
+//Average cache miss ratio (misses per triangle, 0.5 at best, 3 at worst) and average transformed vertex
+//ratio (misses per referenced vertex, 1 at best) of an index buffer, simulating a FIFO cache.
+struct VertexCacheStats {
+	double acmr = 0.0;
+	double atvr = 0.0;
+};
+inline VertexCacheStats vertexCacheStats(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = vertexCacheSize) {
+	VertexCacheStats stats;
+	if (indices.size() < 3 || vertexCount == 0) return stats;
+	//a vertex is cached while fewer than cacheSize misses happened since its own miss
+	std::vector<size_t> missedAt(vertexCount, 0);
+	std::vector<unsigned char> referenced(vertexCount, 0);
+	size_t misses = 0, used = 0;
+	for (unsigned int v : indices) {
+		if (!referenced[v]) { referenced[v] = 1; used++; }
+		if (missedAt[v] == 0 || misses + 1 - missedAt[v] > cacheSize) missedAt[v] = ++misses;
+	}
+	stats.acmr = double(misses) / double(indices.size() / 3);
+	stats.atvr = double(misses) / double(used);
+	return stats;
+}
+
+//Tipsify (Sander, Nehab, Barczak 2007) on one triangle list whose indices are all below vertexCount.
+//Fans around a vertex, then continues with the candidate that is still in the cache and has the fewest
+//live triangles left, falling back to recently used vertices (dead end stack) and then to input order.
+//Linear time, the result is written back into indices.
+inline void tipsifyTriangles(unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = vertexCacheSize) {
+	const size_t triangles = indexCount / 3;
+	if (triangles < 2) return;
+	//vertex -> triangles
+	std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0), adjacency(3 * triangles);
+	for (size_t i = 0; i < 3 * triangles; i++) adjacencyStart[indices[i] + 1]++;
+	for (size_t v = 0; v < vertexCount; v++) adjacencyStart[v + 1] += adjacencyStart[v];
+	std::vector<uint32_t> live(vertexCount), fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+	for (size_t i = 0; i < 3 * triangles; i++) adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+	for (size_t v = 0; v < vertexCount; v++) live[v] = adjacencyStart[v + 1] - adjacencyStart[v];
+	std::vector<uint32_t>().swap(fill);
+
+	std::vector<size_t> cacheTime(vertexCount, 0);
+	std::vector<unsigned char> emitted(triangles, 0);
+	std::vector<uint32_t> deadEnd, candidates;
+	std::vector<unsigned int> output;
+	output.reserve(3 * triangles);
+	size_t time = cacheSize + 1, cursor = 0;
+	auto nextLive = [&]() -> int64_t {
+		while (!deadEnd.empty()) {
+			uint32_t v = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[v] > 0) return v;
+		}
+		for (; cursor < 3 * triangles; cursor++) if (live[indices[cursor]] > 0) return indices[cursor];
+		return -1;
+	};
+	int64_t fan = indices[0];
+	while (fan >= 0) {
+		candidates.clear();
+		for (uint32_t a = adjacencyStart[fan]; a < adjacencyStart[fan + 1]; a++) {
+			const uint32_t t = adjacency[a];
+			if (emitted[t]) continue;
+			emitted[t] = 1;
+			for (int k = 0; k < 3; k++) {
+				const unsigned int v = indices[3 * t + k];
+				output.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - cacheTime[v] > cacheSize) cacheTime[v] = time++;
+			}
+		}
+		//best candidate : still cached once its remaining triangles are emitted, oldest first
+		int64_t best = -1;
+		size_t bestPriority = 0;
+		for (uint32_t v : candidates) {
+			if (live[v] == 0 || time - cacheTime[v] + 2 * live[v] > cacheSize) continue;
+			const size_t priority = time - cacheTime[v];
+			if (priority > bestPriority) { best = v; bestPriority = priority; }
+		}
+		fan = (best >= 0) ? best : nextLive();
+	}
+	std::copy(output.begin(), output.end(), indices);
+}
+
+//Reorders triangles for the post transform cache, each submesh separately so draw ranges stay valid.
+//Submeshes are renumbered to their own vertices first so the per vertex tables only cover what they use.
+inline void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, const std::vector<SubMesh>& subMeshes) {
+	std::vector<SubMesh> ranges = subMeshes;
+	if (ranges.empty()) ranges.push_back({ 0, static_cast<unsigned int>(indices.size()) });
+	std::vector<uint32_t> localOf(vertexCount, UINT32_MAX), globalOf;
+	std::vector<unsigned int> local;
+	for (const SubMesh& range : ranges) {
+		unsigned int* first = indices.data() + range.firstIndex;
+		const size_t count = range.indexCount - range.indexCount % 3;
+		globalOf.clear();
+		local.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			uint32_t& id = localOf[first[i]];
+			if (id == UINT32_MAX) { id = uint32_t(globalOf.size()); globalOf.push_back(first[i]); }
+			local[i] = id;
+		}
+		tipsifyTriangles(local.data(), count, globalOf.size());
+		for (size_t i = 0; i < count; i++) first[i] = globalOf[local[i]];
+		for (uint32_t v : globalOf) localOf[v] = UINT32_MAX;
+	}
+}
+
+//Moves vertex i to newIndex[i] in every per vertex array (arrays of another size are left alone) and remaps indices.
+inline void permuteVertices(const std::vector<uint32_t>& newIndex, std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals,
+	std::vector<glm::vec2>* uvs, std::vector<unsigned int>& indices) {
+	ThreadPool& pool = globalThreadPool();
+	const size_t n = newIndex.size();
+	auto permute = [&](auto& values) {
+		if (values.size() != n) return;
+		typename std::remove_reference<decltype(values)>::type reordered(n);
+		pool.parallelFor(0, n, 1 << 16, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) reordered[newIndex[i]] = values[i];
+		});
+		values.swap(reordered);
+	};
+	permute(vertices);
+	permute(normals);
+	if (uvs) permute(*uvs);
+	pool.parallelFor(0, indices.size(), 1 << 16, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) indices[i] = newIndex[indices[i]];
+	});
+}
+
+//Renumbers vertices in the order the index buffer first references them, so vertex fetches and the
+//per face compute passes gather from nearby memory. Unreferenced vertices go last.
+inline void reorderVerticesByFirstUse(std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals, std::vector<glm::vec2>* uvs,
+	std::vector<unsigned int>& indices) {
+	const size_t n = vertices.size();
+	std::vector<uint32_t> newIndex(n, UINT32_MAX);
+	uint32_t next = 0;
+	for (unsigned int v : indices) if (newIndex[v] == UINT32_MAX) newIndex[v] = next++;
+	for (size_t i = 0; i < n; i++) if (newIndex[i] == UINT32_MAX) newIndex[i] = next++;
+	permuteVertices(newIndex, vertices, normals, uvs, indices);
+}
+
+//Spreads the low 21 bits of x three apart.
+inline uint64_t mortonSpread(uint64_t x) {
+	x &= 0x1fffff;
+	x = (x | x << 32) & 0x1f00000000ffffull;
+	x = (x | x << 16) & 0x1f0000ff0000ffull;
+	x = (x | x << 8) & 0x100f00f00f00f00full;
+	x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+	x = (x | x << 2) & 0x1249249249249249ull;
+	return x;
+}
+//Position on a Z order curve over the box [minCorner, maxCorner], 21 bits per axis.
+inline uint64_t mortonCode(const glm::vec3& p, const glm::vec3& minCorner, const glm::vec3& maxCorner) {
+	uint64_t code = 0;
+	for (int k = 0; k < 3; k++) {
+		const float extent = maxCorner[k] - minCorner[k];
+		const float t = extent > 0.0f ? (p[k] - minCorner[k]) / extent : 0.0f;
+		code |= mortonSpread(uint64_t(std::min(std::max(t, 0.0f), 1.0f) * 2097151.0f)) << k;
+	}
+	return code;
+}
+
+//Renumbers vertices along a Morton curve of their positions, so vertices close in space are close in memory
+//whatever order the file had. Helps the passes that gather from a vertex's neighbours (Dt1q1, adjacent faces).
+inline void reorderVerticesAlongCurve(std::vector<glm::vec3>& vertices, std::vector<glm::vec3>& normals, std::vector<glm::vec2>* uvs,
+	std::vector<unsigned int>& indices) {
+	const size_t n = vertices.size();
+	if (n < 2) return;
+	glm::vec3 minCorner = vertices[0], maxCorner = vertices[0];
+	for (const glm::vec3& v : vertices) { minCorner = glm::min(minCorner, v); maxCorner = glm::max(maxCorner, v); }
+	std::vector<std::pair<uint64_t, uint32_t>> order(n);
+	ThreadPool& pool = globalThreadPool();
+	pool.parallelFor(0, n, 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) order[i] = { mortonCode(vertices[i], minCorner, maxCorner), uint32_t(i) };
+	});
+	std::sort(order.begin(), order.end());
+	std::vector<uint32_t> newIndex(n);
+	for (size_t i = 0; i < n; i++) newIndex[order[i].second] = uint32_t(i);
+	permuteVertices(newIndex, vertices, normals, uvs, indices);
+}
+
+//Mean |a - b| over the edges of every triangle : how far apart in memory the neighbour gathers land.
+inline double meanEdgeIndexDistance(const std::vector<unsigned int>& indices) {
+	const size_t triangles = indices.size() / 3;
+	if (triangles == 0) return 0.0;
+	double sum = 0.0;
+	for (size_t t = 0; t < triangles; t++) {
+		for (int k = 0; k < 3; k++) {
+			const int64_t a = indices[3 * t + k], b = indices[3 * t + (k + 1) % 3];
+			sum += double(a > b ? a - b : b - a);
+		}
+	}
+	return sum / double(3 * triangles);
+}
+
+#endif
@@ -1,9 +1,16 @@
+#ifndef MODEL_H
+#define MODEL_H
 #include <vector>
 #include <array>
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <chrono>
+#include <memory>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <future>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
@@ -12,8 +19,120 @@
 #include <assimp/postprocess.h>     
 
 #include "LoadShader.h"
+#include "MeshCache.h"
+#include "MeshProcessing.h"
+#include "ObjLoader.h"
+#include "PlyLoader.h"
+#include "StagingRing.h"
+#include "FrameUniforms.h"
+#include "CurvatureCPU.h"
+#include "ViewDependentCPU.h"
 const unsigned int workGroupSize = 1024;
+//Post processing used for every import. Part of the cache key, so changing this invalidates old caches.
+//Vertices are welded by Model::weldMesh() instead of aiProcess_JoinIdenticalVertices,
+//missing normals are generated by completeVertexNormals() / Model::generateNormals() instead of aiProcess_GenSmoothNormals.
+const unsigned int assimpImportFlags = aiProcess_Triangulate | aiProcess_CalcTangentSpace | aiProcess_GenUVCoords; //aiProcess_JoinIdenticalVertices | aiProcess_SortByPType);
 bool loadAssimp(const char* path,std::vector<glm::vec3>& out_vertices,std::vector<glm::vec3>& out_normals,std::vector<unsigned int>& out_indices);
+//Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER.
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+//Layout glDrawArraysIndirect reads, apparentRidges.compute counts its segment vertices in count.
+struct DrawArraysIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint first;
+	GLuint baseInstance;
+};
+//Layout glDispatchComputeIndirect reads.
+struct DispatchIndirectCommand {
+	GLuint numGroupsX;
+	GLuint numGroupsY;
+	GLuint numGroupsZ;
+};
+//Written by ridgeCandidates.compute : a dispatch over every candidate list, each followed by the list's length.
+struct RidgeCandidateDispatch {
+	DispatchIndirectCommand vertices;
+	GLuint vertexCount;
+	DispatchIndirectCommand edges;
+	GLuint edgeCount;
+	DispatchIndirectCommand faces;
+	GLuint faceCount;
+};
+//Written by clusterCull.compute : a dispatch over the visible vertices (with their one ring) and faces, each followed by the count.
+struct VisibleClusterDispatch {
+	DispatchIndirectCommand vertices;
+	GLuint vertexCount;
+	DispatchIndirectCommand faces;
+	GLuint faceCount;
+};
+//Assimp matrices are row major.
+glm::mat4 toGlm(const aiMatrix4x4& m) {
+	return glm::mat4(glm::vec4(m.a1, m.b1, m.c1, m.d1), glm::vec4(m.a2, m.b2, m.c2, m.d2),
+		glm::vec4(m.a3, m.b3, m.c3, m.d3), glm::vec4(m.a4, m.b4, m.c4, m.d4));
+}
+//Appends one mesh instance, transformed by its node's world matrix. Non triangle primitives are dropped.
+//Meshes without normals get zero ones, for completeVertexNormals() to fill in.
+void appendAssimpMesh(const aiMesh* mesh, const glm::mat4& transform, std::vector<glm::vec3>& out_vertices, std::vector<glm::vec3>& out_normals,
+	std::vector<glm::vec2>* out_uvs, std::vector<unsigned int>& out_indices, std::vector<SubMesh>& out_subMeshes) {
+	const GLuint baseVertex = GLuint(out_vertices.size());
+	const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
+	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+		aiVector3D pos = mesh->mVertices[i];
+		out_vertices.push_back(glm::vec3(transform * glm::vec4(pos.x, pos.y, pos.z, 1.0f)));
+		glm::vec3 n(0.0f);
+		if (mesh->HasNormals()) {
+			n = normalMatrix * glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+			n = glm::length(n) > 0.0f ? glm::normalize(n) : glm::vec3(0.0f, 0.0f, 1.0f);
+		}
+		out_normals.push_back(n);
+		if (out_uvs) {
+			// Assume only 1 set of UV coords; AssImp supports 8 UV sets.
+			aiVector3D UVW = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0][i] : aiVector3D{ 0.0f, 0.0f, 0.0f };
+			out_uvs->push_back(glm::vec2(UVW.x, UVW.y));
+		}
+	}
+	SubMesh subMesh = { GLuint(out_indices.size()), 0 };
+	for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+		if (mesh->mFaces[i].mNumIndices != 3) continue;
+		for (unsigned int j = 0; j < 3; j++) out_indices.push_back(baseVertex + mesh->mFaces[i].mIndices[j]);
+	}
+	subMesh.indexCount = GLuint(out_indices.size()) - subMesh.firstIndex;
+	if (subMesh.indexCount) out_subMeshes.push_back(subMesh);
+}
+void appendAssimpNode(const aiScene* scene, const aiNode* node, const glm::mat4& parentTransform, std::vector<glm::vec3>& out_vertices, std::vector<glm::vec3>& out_normals,
+	std::vector<glm::vec2>* out_uvs, std::vector<unsigned int>& out_indices, std::vector<SubMesh>& out_subMeshes) {
+	const glm::mat4 transform = parentTransform * toGlm(node->mTransformation);
+	for (unsigned int i = 0; i < node->mNumMeshes; i++)
+		appendAssimpMesh(scene->mMeshes[node->mMeshes[i]], transform, out_vertices, out_normals, out_uvs, out_indices, out_subMeshes);
+	for (unsigned int i = 0; i < node->mNumChildren; i++)
+		appendAssimpNode(scene, node->mChildren[i], transform, out_vertices, out_normals, out_uvs, out_indices, out_subMeshes);
+}
+//Merges every mesh instance in the scene into one vertex / index set with node transforms baked in,
+//one SubMesh per instance. Scenes without a node graph take their meshes untransformed.
+void mergeAssimpScene(const aiScene* scene, std::vector<glm::vec3>& out_vertices, std::vector<glm::vec3>& out_normals,
+	std::vector<glm::vec2>* out_uvs, std::vector<unsigned int>& out_indices, std::vector<SubMesh>& out_subMeshes) {
+	if (scene->mRootNode) {
+		appendAssimpNode(scene, scene->mRootNode, glm::mat4(1.0f), out_vertices, out_normals, out_uvs, out_indices, out_subMeshes);
+	}
+	else {
+		for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+			appendAssimpMesh(scene->mMeshes[i], glm::mat4(1.0f), out_vertices, out_normals, out_uvs, out_indices, out_subMeshes);
+	}
+}
+//Lower case extension without the dot, "" if there is none.
+std::string fileExtension(const std::string& path) {
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("\\/");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return "";
+	std::string extension = path.substr(dot + 1);
+	for (char& c : extension) c = char(tolower((unsigned char)c));
+	return extension;
+}
 void printVec(glm::vec3 v) {
 	std::cout <<"(" << v.x << ", " << v.y << ", " << v.z << ") ";
 }
@@ -23,20 +142,40 @@ void printVec(glm::vec4 v) {
 
 class Model {
 public:
-	//Handles
+	//Handles, 0 while not created
 	//Buffers
-	GLuint VAO, positionBuffer, normalBuffer, textureBuffer, EBO;
-	GLuint PDBuffer, CurvatureBuffer;
-	GLuint maxPDVBO, maxCurvVBO, minPDVBO, minCurvVBO;
-	GLuint vertexStorageBuffer, normalStorageBuffer, indexStorageBuffer; 
+	GLuint VAO = 0, positionBuffer = 0, normalBuffer = 0, textureBuffer = 0, EBO = 0;
+	GLuint PDBuffer = 0, CurvatureBuffer = 0, DCurvBuffer = 0;
+	GLuint maxPDVBO = 0, maxCurvVBO = 0, minPDVBO = 0, minCurvVBO = 0;
+	GLuint vertexStorageBuffer = 0, normalStorageBuffer = 0, indexStorageBuffer = 0;
 	//q1 : max view-dep curvature, t1 : max view-dep curvature direction
 	//Dt1q1 : max view-dependent curvature's directional derivative in direction t1
 	//TODO : These should be static
-	GLuint adjacentFacesBuffer, q1Buffer, t1Buffer, Dt1q1Buffer;
-	GLuint pointAreaBuffer, cornerAreaBuffer;
+	GLuint q1Buffer = 0, t1Buffer = 0, Dt1q1Buffer = 0;
+	GLuint cornerOffsetBuffer = 0, vertexCornerBuffer = 0; //vertex -> corner lists (CSR), see findAdjacentFaces()
+	GLuint pointAreaBuffer = 0, cornerAreaBuffer = 0;
+	GLuint indirectBuffer = 0; //one DrawElementsIndirectCommand per submesh
+	//apparent ridge segments (2 vec4s each) and the DrawArraysIndirectCommand drawing them, see extractRidges()
+	GLuint ridgeSegmentBuffer = 0, ridgeCommandBuffer = 0;
+	//unique edges (MeshEdges) and the per vertex / per edge results of the ridge extraction passes, see uploadMeshEdges()
+	GLuint edgeBuffer = 0, faceEdgeBuffer = 0, ridgeVertexBuffer = 0, edgePointBuffer = 0;
+	GLuint numEdges = 0;
+	//vertices / edges / faces that can be part of a ridge at the current threshold, see findRidgeCandidates()
+	GLuint ridgeDispatchBuffer = 0, candidateVertexBuffer = 0, candidateEdgeBuffer = 0, candidateFaceBuffer = 0, vertexMarkBuffer = 0, edgeMarkBuffer = 0;
+	GLuint candidateStamp = 0;
+	//~128 face clusters (MeshClusters) and the vertices / faces of the ones in view, see cullClusters()
+	MeshClusters meshClusters;
+	GLuint clusterBuffer = 0, clusterVertexBuffer = 0, visibleDispatchBuffer = 0, visibleVertexBuffer = 0, visibleFaceBuffer = 0, visibleMarkBuffer = 0;
+	GLuint visibleStamp = 0;
 
 	//shaders
-	GLuint viewDepCurvatureCompute, Dt1q1Compute, pointAreaCompute;
+	GLuint viewDepCurvatureCompute = 0, Dt1q1Compute = 0, clusterCullCompute = 0;
+	//apparent ridge extraction : per vertex tmax, per edge crossings, per face segments
+	GLuint ridgeCandidateCompute = 0, ridgeVertexCompute = 0, ridgeEdgeCompute = 0, ridgeExtractionCompute = 0;
+	//updateCurvatures() programs (per face, per vertex) and per corner buffers, created on first use
+	GLuint vertexUpdateCompute = 0, areaUpdateCompute[2] = {}, curvatureUpdateCompute[2] = {}, dcurvUpdateCompute[2] = {};
+	GLuint cornerCurvBuffers[3] = {}, cornerDcurvBuffer = 0;
+	RingQuery ringQuery;
 
 	std::vector<glm::vec3> vertices;
 	std::vector<glm::vec3> normals;
@@ -45,10 +184,12 @@ public:
 	std::vector<glm::vec3> tangents;
 	std::vector<glm::vec3> bitangents;
 	std::vector<GLuint> indices;
+	std::vector<SubMesh> subMeshes; //ranges of indices per source mesh, all drawn with one indirect call
 
 	std::vector<glm::vec4> PDs;
 	std::vector<GLfloat> PrincipalCurvatures;
-	std::vector<std::array<int, 20>> adjacentFaces; //10 pairs of indices of adjacent edges to the vertex
+	std::vector<glm::vec4> dcurvs; //derivative of the curvature tensor (C_uuu, C_uuv, C_uvv, C_vvv) in the (max, min) PDs
+	VertexCorners vertexCorners; //corners (so faces and opposite edges) around every vertex, any valence
 	std::vector<GLfloat> pointAreas; //for every vertex 
 	std::vector<GLfloat> cornerAreas; //for every index 
 
@@ -61,10 +202,10 @@ public:
 	std::vector<glm::vec2> t1s;
 	std::vector<float> Dt1q1s;
 
-	unsigned int numVertices;
-	unsigned int numNormals;
-	unsigned int numFaces;
-	unsigned int numIndices;
+	unsigned int numVertices = 0;
+	unsigned int numNormals = 0;
+	unsigned int numFaces = 0;
+	unsigned int numIndices = 0;
 
 	std::string path;
 	GLfloat diagonalLength = 0.0f;
@@ -76,19 +217,104 @@ public:
 	bool curvaturesCalculated = false;
 	bool apparentRidges = false;
 	bool printed = false;
+	bool useCache = true;
+	bool streamUploads = true; //vertex / normal / index SSBOs go through the persistently mapped staging ring, no vec4 staging arrays
+	//with streamUploads : .obj / .ply files are parsed in uploadGL() and every chunk streamed to the SSBOs as soon as
+	//it's parsed (ingestMesh()). Only used with weldOnLoad, optimizeOnLoad and regenerateNormals off, which rewrite the mesh after parsing.
+	bool streamIngest = false;
+	bool ingestPending = false; //loadCPU() left parsing to ingestMesh()
+	bool weldOnLoad = true;
+	float weldTolerance = 1e-6f; //relative to the bounding box diagonal, 0 only merges identical positions
+	bool optimizeOnLoad = true; //triangles reordered for the vertex cache, vertices renumbered in first use order
+	bool spaceFillingOrder = false; //with optimizeOnLoad : vertices sorted along a Morton curve instead of first use order
+	bool adjacencyOnGPU = true; //vertex -> corner lists built by compute passes, by buildVertexCorners() otherwise
+	bool regenerateNormals = false; //normals rebuilt from the welded mesh by generateNormals() instead of taken from the file
+	NormalWeighting normalWeighting = NORMALS_ANGLE; //with regenerateNormals
+	bool useNativeLoaders = true; //.obj / .ply files are read by ObjLoader.h / PlyLoader.h instead of Assimp
+	bool loadedFromCache = false;
+	bool loaded = false; //CPU stage succeeded
+	bool hostArraysCurrent = false; //host copies of every load time result match the GPU (cache load / read back)
+	bool edited = false; //moveVertices() changed the mesh : the host arrays are the only copy of it, releaseHost() keeps them
+	uint64_t sourceHash = 0;
+	uint64_t sourceSize = 0;
+	//kept mapped between the CPU and GL stages so the SSBOs can be filled straight from it
+	std::shared_ptr<MeshCache> mappedCache;
+	//vec4 staging arrays for the SSBOs, built on the CPU stage and released after upload
+	std::vector<glm::vec4> vertexStorage;
+	std::vector<glm::vec4> normalStorage;
 
 	//Debugging area
 	glm::mat4 modelMatrix;
-
-	Model(std::string path) {
+	glm::vec3 viewPosition = glm::vec3(0.0f); //camera, set every frame like modelMatrix
+	float ridgeThreshold = 0.0f; //the frame's apparent ridge threshold, decides which vertices get Dt1q1
+	glm::mat4 viewProjection = glm::mat4(1.0f); //the frame's projection * view, clusters outside it are culled
+	bool cullBackFacing = false; //the frame's cull flag, clusters facing away are culled
+	//viewDependentInputsHash() when q1 / t1 / Dt1q1 were last computed, 0 if they're stale
+	uint64_t viewDependentInputs = 0;
+
+	//Empty model, filled in later by loadCPU() / uploadGL() (see ModelResidency).
+	Model() {}
+	//uploadNow = false only runs the CPU stage, so the model can be built on a worker thread.
+	//uploadGL() must then be called on the thread that owns the GL context.
+	Model(std::string path, bool useCache = true, bool uploadNow = true) {
 		this->path = path;
-		if (!this->loadAssimp()) { std::cout << "Model at "<<path<<" not loaded!\n"; };
+		this->useCache = useCache;
+		this->loadCPU();
+		if (uploadNow) this->uploadGL();
+	}
+	//CPU stage : parse (or map the cache), weld, bounds and the vec4 staging arrays. No GL calls.
+	bool loadCPU() {
+		//Cached meshes skip Assimp and every load time compute pass.
+		bool cached = useCache && this->loadCache();
+		if (!cached && this->ingestOnUpload()) {
+			this->ingestPending = true;
+			this->loaded = true;
+			return true;
+		}
+		if (!cached && !this->loadMesh()) { std::cout << "Model at "<<path<<" not loaded!\n"; return false; };
+		this->prepareMesh(cached);
+		this->loaded = true;
+		return true;
+	}
+	//Everything after parsing : bounds, weld, reorder, normals and the vec4 staging arrays.
+	void prepareMesh(bool cached) {
 		this->boundingBox();
+		if (!cached && this->weldOnLoad) this->weldMesh();
+		if (!cached && this->optimizeOnLoad) this->optimizeMesh();
+		if (!cached && this->regenerateNormals) this->generateNormals();
 		this->minDistance = this->getMinDistance();
 		this->size = this->vertices.size();
-		this->computeCurvatures(); 
-		this->findAdjacentFaces();
+		if (!cached && !this->streamUploads) this->buildStorageArrays();
+	}
+	bool ingestOnUpload() const {
+		return this->streamIngest && this->streamUploads && this->usesNativeLoader() && !this->weldOnLoad && !this->optimizeOnLoad && !this->regenerateNormals;
+	}
+	//GL stage : uploads and load time compute passes.
+	void uploadGL() {
+		if (!this->loaded) return;
+		if (this->ingestPending && !this->ingestMesh()) { this->loaded = false; return; }
+		if (this->mappedCache) {
+			this->uploadCache();
+		}
+		else if (this->hostArraysCurrent) {
+			//coming back after releaseGL()
+			this->uploadHostArrays();
+		}
+		else {
+			this->computeCurvatures(); 
+			if (useCache) this->writeCache();
+		}
 		this->setup();
+		//staging copies are on the GPU now
+		std::vector<glm::vec4>().swap(this->vertexStorage);
+		std::vector<glm::vec4>().swap(this->normalStorage);
+	}
+	//Name shown in the UI : file name without directory or extension.
+	std::string name() const {
+		size_t slash = path.find_last_of("\\/");
+		std::string file = (slash == std::string::npos) ? path : path.substr(slash + 1);
+		size_t dot = file.find_last_of('.');
+		return (dot == std::string::npos) ? file : file.substr(0, dot);
 	}
 	void setup() {
 		//std::cout << "Setting up buffers.\n";
@@ -116,6 +342,14 @@ public:
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
+		//Indirect draw commands, one per submesh
+		if (subMeshes.empty()) subMeshes.push_back({ 0, GLuint(indices.size()) });
+		std::vector<DrawElementsIndirectCommand> drawCommands;
+		for (const SubMesh& subMesh : subMeshes) drawCommands.push_back({ subMesh.indexCount, 1, subMesh.firstIndex, 0, 0 });
+		glGenBuffers(1, &indirectBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, drawCommands.size() * sizeof(DrawElementsIndirectCommand), drawCommands.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 
 
 		glEnableVertexAttribArray(0);
@@ -178,18 +412,6 @@ public:
 		}
 		else { this->computeCurvatures(); this->setup(); }
 
-		//adjacent faces
-		
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 20, adjacentFacesBuffer);
-		glGetNamedBufferSubData(adjacentFacesBuffer, 0, adjacentFaces.size() * sizeof(glm::vec4), adjacentFaces.data());
-		for (int dbg = 0; dbg < 1; dbg++) {
-			std::cout << "Adjacent to " << dbg<<" : ";
-			for (int j = 0; j < 10; j++) {
-				std::cout << adjacentFaces[dbg][2 * j] << ", " << adjacentFaces[dbg][2 * j + 1] << ". ";
-			}
-			std::cout << "\n";
-		}
-
 		q1s.resize(this->numVertices,0.0f);
 		glGenBuffers(1, &q1Buffer);
 		glBindBuffer(GL_SHADER_STORAGE_BUFFER, q1Buffer);
@@ -207,20 +429,152 @@ public:
 		glBindBuffer(GL_SHADER_STORAGE_BUFFER, Dt1q1Buffer);
 		glBufferData(GL_SHADER_STORAGE_BUFFER, Dt1q1s.size() * sizeof(GLfloat), Dt1q1s.data(), GL_DYNAMIC_DRAW);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 23, Dt1q1Buffer);
+		this->viewDependentInputs = 0;
+
+		//3 segments per face at most
+		const DrawArraysIndirectCommand ridgeCommand = { 0, 1, 0, 0 };
+		ridgeSegmentBuffer = createStorageBuffer(24, std::max<size_t>(1, this->numIndices / 3) * 6 * sizeof(glm::vec4), nullptr);
+		ridgeCommandBuffer = createStorageBuffer(25, sizeof(DrawArraysIndirectCommand), &ridgeCommand);
+		this->uploadMeshEdges();
+		this->uploadMeshClusters();
 
 		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glBindVertexArray(0);
 
 		//shaders for apparent ridges
+		this->clusterCullCompute = loadComputeShader(".\\shaders\\clusterCull.compute");
 		this->viewDepCurvatureCompute = loadComputeShader(".\\shaders\\viewDepCurv.compute");
 		this->Dt1q1Compute = loadComputeShader(".\\shaders\\Dt1q1.compute");
+		this->ridgeCandidateCompute = loadComputeShader(".\\shaders\\ridgeCandidates.compute");
+		this->ridgeVertexCompute = loadComputeShader(".\\shaders\\ridgeVertices.compute");
+		this->ridgeEdgeCompute = loadComputeShader(".\\shaders\\ridgeEdges.compute");
+		this->ridgeExtractionCompute = loadComputeShader(".\\shaders\\apparentRidges.compute");
 
 		//std::cout << "Ready to render.\n";
 		this->isSet = true;
 
 		return;
 	}
+	//One thread per vertex of a view dependent pass, SSBOs and the frame uniforms must already be bound.
+	void dispatchPerVertex(GLuint program) {
+		glUseProgram(program);
+		//explicit location, the camera comes from the DrawConstants block (FrameUniforms.h)
+		glUniform1ui(0, this->numVertices);
+		glDispatchCompute(glm::ceil(GLfloat(this->numVertices) / float(workGroupSize)), 1, 1);
+		glMemoryBarrier(GL_ALL_BARRIER_BITS);
+	}
+	//Camera moved into the model's object space, once per frame on the CPU. The view dependent passes and the
+	//ridge shaders work in object space with it and only apply modelMatrix for the projection.
+	glm::vec3 objectViewPosition() const {
+		return glm::vec3(glm::inverse(this->modelMatrix) * glm::vec4(this->viewPosition, 1.0f));
+	}
+	//Everything the view dependent passes read that changes between frames : the object space camera, so moving
+	//the model and the camera together doesn't recompute anything, the threshold, which picks the vertices
+	//Dt1q1 runs on (findRidgeCandidates()), and the object -> clip matrix and cull flag, which pick the visible
+	//clusters (cullClusters()).
+	//Curvatures changing (setup(), updateCurvatures()) resets viewDependentInputs instead. Never 0.
+	uint64_t viewDependentInputsHash() const {
+		const glm::vec3 camera = this->objectViewPosition();
+		const glm::mat4 clip = this->viewProjection * this->modelMatrix;
+		uint64_t hash = hashBytes(&camera.x, sizeof(glm::vec3));
+		hash = hashBytes(&this->ridgeThreshold, sizeof(float), hash);
+		hash = hashBytes(&clip[0][0], sizeof(glm::mat4), hash);
+		hash = hashBytes(&this->cullBackFacing, sizeof(bool), hash);
+		return hash | 1u;
+	}
+	//Lists the vertices (with their one ring) and faces of the clusters in view, and facing the camera if
+	//cullBackFacing (clusterCull.compute). The view dependent passes and findRidgeCandidates() only run over these,
+	//through glDispatchComputeIndirect. Needs the frame uniforms.
+	void cullClusters() {
+		//vertices are claimed with a stamp per frame, cleared only when it wraps around
+		if (++this->visibleStamp == 0) {
+			glClearNamedBufferData(visibleMarkBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+			this->visibleStamp = 1;
+		}
+		const VisibleClusterDispatch reset = { { 0, 1, 1 }, 0, { 0, 1, 1 }, 0 };
+		glNamedBufferSubData(visibleDispatchBuffer, 0, sizeof(reset), &reset);
+		glUseProgram(clusterCullCompute);
+		//explicit locations
+		glUniform1ui(0, GLuint(this->meshClusters.size()));
+		glUniform1ui(1, this->visibleStamp);
+		glDispatchCompute(glm::ceil(GLfloat(this->meshClusters.size()) / float(workGroupSize)), 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+	}
+	//Lists the visible faces with a vertex above the threshold, their vertices and their edges (ridgeCandidates.compute).
+	//Every other face fails the extraction's initial filter, so Dt1q1 and the extraction passes only run over
+	//these lists through glDispatchComputeIndirect. Needs cullClusters(), q1 and the frame uniforms.
+	void findRidgeCandidates() {
+		//vertices / edges are claimed with a stamp per build, cleared only when it wraps around
+		if (++this->candidateStamp == 0) {
+			glClearNamedBufferData(vertexMarkBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+			glClearNamedBufferData(edgeMarkBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+			this->candidateStamp = 1;
+		}
+		const RidgeCandidateDispatch reset = { { 0, 1, 1 }, 0, { 0, 1, 1 }, 0, { 0, 1, 1 }, 0 };
+		glNamedBufferSubData(ridgeDispatchBuffer, 0, sizeof(reset), &reset);
+		glUseProgram(ridgeCandidateCompute);
+		glUniform1ui(1, this->candidateStamp); //explicit location
+		this->dispatchIndirect(visibleDispatchBuffer, offsetof(VisibleClusterDispatch, faces));
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+	}
+	//One thread per entry of a visible / candidate list, the current program's uniforms must already be set.
+	void dispatchIndirect(GLuint dispatchBuffer, size_t dispatchOffset) {
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, dispatchBuffer);
+		glDispatchComputeIndirect(GLintptr(dispatchOffset));
+		glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+	//Apparent ridge extraction over the candidate lists. Per vertex tmax (ridgeVertices.compute), the crossing on
+	//every edge (ridgeEdges.compute), then per face (apparentRidges.compute) connecting the edge points into segments.
+	//Replaces ridgeSegmentBuffer with this frame's segments and their vertex count in ridgeCommandBuffer.
+	//q1 / t1 / Dt1q1 and the frame uniforms must be current.
+	void extractRidges() {
+		const DrawArraysIndirectCommand reset = { 0, 1, 0, 0 };
+		glNamedBufferSubData(ridgeCommandBuffer, 0, sizeof(reset), &reset);
+		this->rebindSSBOs();
+		//over the lists of the last findRidgeCandidates()
+		glUseProgram(ridgeVertexCompute);
+		glUniform1ui(0, this->numVertices); //explicit location
+		this->dispatchIndirect(ridgeDispatchBuffer, offsetof(RidgeCandidateDispatch, vertices));
+		glUseProgram(ridgeEdgeCompute);
+		this->dispatchIndirect(ridgeDispatchBuffer, offsetof(RidgeCandidateDispatch, edges));
+		glUseProgram(ridgeExtractionCompute);
+		this->dispatchIndirect(ridgeDispatchBuffer, offsetof(RidgeCandidateDispatch, faces));
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+	}
+	//Draws the segments of the last extractRidges() as GL_LINES, with the vertex count the GPU wrote.
+	//shader reads the segments from binding 24 (ridgeLines.vs).
+	void renderRidges(GLuint shader) {
+		glUseProgram(shader);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 24, ridgeSegmentBuffer);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, ridgeCommandBuffer);
+		glDrawArraysIndirect(GL_LINES, nullptr);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	//Segments of the last extractRidges(). Reads back from the GPU, so it waits for the extraction.
+	GLuint ridgeSegmentCount() {
+		DrawArraysIndirectCommand command = {};
+		glGetNamedBufferSubData(ridgeCommandBuffer, 0, sizeof(command), &command);
+		return command.count / 2;
+	}
+	//Writes the segments of the last extractRidges() as OBJ lines, in object space. Fade isn't kept.
+	bool exportRidges(const std::string& outputPath) {
+		const GLuint segmentCount = this->ridgeSegmentCount();
+		std::vector<glm::vec4> segments(size_t(segmentCount) * 2);
+		if (!segments.empty()) glGetNamedBufferSubData(ridgeSegmentBuffer, 0, segments.size() * sizeof(glm::vec4), segments.data());
+		std::ofstream file(outputPath);
+		if (!file) {
+			std::cout << "Failed to open " << outputPath << "\n";
+			return false;
+		}
+		file << "# apparent ridges of " << this->path << ", " << segmentCount << " segments\n";
+		for (const glm::vec4& v : segments) file << "v " << v.x << " " << v.y << " " << v.z << "\n";
+		for (GLuint i = 0; i < segmentCount; i++) file << "l " << 2 * i + 1 << " " << 2 * i + 2 << "\n";
+		std::cout << "Exported " << segmentCount << " ridge segments to " << outputPath << "\n";
+		return true;
+	}
 	//draw function
 	bool render(GLuint shader) {
 
@@ -268,14 +622,18 @@ public:
 			}
 
 			glBindVertexArray(VAO);
-			//Compute View-dep curvatures (q1), and direction (t1)
-			glUseProgram(viewDepCurvatureCompute);
-			glUniform1ui(glGetUniformLocation(viewDepCurvatureCompute, "verticesSize"), this->numVertices);
-			
-			glUniformMatrix4fv(glGetUniformLocation(viewDepCurvatureCompute, "model"), 1, GL_FALSE, &this->modelMatrix[0][0]);
-
-			glDispatchCompute(glm::ceil(GLfloat(this->numVertices) / float(workGroupSize)), 1, 1);
-			glMemoryBarrier(GL_ALL_BARRIER_BITS);
+			//Nothing moved since the last frame : q1 / t1 / Dt1q1 in their buffers are still right
+			const uint64_t inputs = this->viewDependentInputsHash();
+			const bool viewChanged = (inputs != this->viewDependentInputs);
+			//Compute View-dep curvatures (q1), and direction (t1), only for the clusters in view
+			if (viewChanged) {
+				this->cullClusters();
+				glUseProgram(viewDepCurvatureCompute);
+				glUniform1ui(0, this->numVertices);
+				glUniform1i(1, GL_TRUE); //compacted
+				this->dispatchIndirect(visibleDispatchBuffer, offsetof(VisibleClusterDispatch, vertices));
+				glUniform1i(1, GL_FALSE); //dispatchPerVertex() runs it over every vertex
+			}
 
 			if (!printed) {
 				std::cout << "After view dep curvature " << " : \n";
@@ -299,12 +657,16 @@ public:
 				std::cout << "\n";
 			}
 
-			//Compute View-dep curvature derivatives (Dt1q1)
-			glUseProgram(Dt1q1Compute);
-			glUniform1ui(glGetUniformLocation(Dt1q1Compute, "verticesSize"), this->numVertices);
-			glUniformMatrix4fv(glGetUniformLocation(Dt1q1Compute, "model"), 1, GL_FALSE, &this->modelMatrix[0][0]);
-			glDispatchCompute(glm::ceil(GLfloat(this->numVertices) / float(workGroupSize)), 1, 1);
-			glMemoryBarrier(GL_ALL_BARRIER_BITS);
+			//Compute View-dep curvature derivatives (Dt1q1), only where a ridge can pass the threshold
+			if (viewChanged) {
+				this->findRidgeCandidates();
+				glUseProgram(Dt1q1Compute);
+				glUniform1ui(0, this->numVertices);
+				glUniform1i(1, GL_TRUE); //compacted
+				this->dispatchIndirect(ridgeDispatchBuffer, offsetof(RidgeCandidateDispatch, vertices));
+				glUniform1i(1, GL_FALSE); //dispatchPerVertex() runs it over every vertex
+			}
+			this->viewDependentInputs = inputs;
 
 
 
@@ -336,7 +698,11 @@ public:
 		glUseProgram(shader);
 
 		
-		glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
+		//Every submesh in one call
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, GLsizei(subMeshes.size()), 0);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 
 		//glDisableVertexAttribArray(0);
 		//glDisableVertexAttribArray(1);
@@ -380,6 +746,7 @@ public:
 
 		//So we need to initially compute by face.
 		//Load compute shader
+		GLuint frames = loadComputeShader(".\\shaders\\curvature_frames.compute");
 		GLuint perFace = loadComputeShader(".\\shaders\\curvature_perFace.compute");
 		GLuint perVertex = loadComputeShader(".\\shaders\\curvature_perVertex.compute");
 
@@ -402,34 +769,39 @@ public:
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, CurvatureBuffer);
 
 		//for reading
-		//Vertex positions
-		glGenBuffers(1, &vertexStorageBuffer);
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexStorageBuffer);
-		std::vector<glm::vec4> vertexStorage;
-		for (auto v : vertices) { //make vec4s from vec3s
-			vertexStorage.push_back(glm::vec4(v, 1.0f));
-		}
-		glBufferData(GL_SHADER_STORAGE_BUFFER, vertexStorage.size() * sizeof(glm::vec4), vertexStorage.data(), GL_DYNAMIC_DRAW);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, vertexStorageBuffer);
-
-		//normals
-		glGenBuffers(1, &normalStorageBuffer);
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, normalStorageBuffer);
-		std::vector<glm::vec4> normalStorage;
-		for (auto v : normals) {
-			normalStorage.push_back(glm::vec4(v, 0.0f));
+		//Vertex positions, normals, indices
+		if (vertexStorageBuffer) {
+			//already streamed while parsing, see ingestMesh()
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, vertexStorageBuffer);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, normalStorageBuffer);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, indexStorageBuffer);
+		}
+		else if (this->streamUploads && stagingRing().isMapped()) this->streamStorageBuffers();
+		else {
+			if (vertexStorage.size() != vertices.size()) this->buildStorageArrays();
+			glGenBuffers(1, &vertexStorageBuffer);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexStorageBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, vertexStorage.size() * sizeof(glm::vec4), vertexStorage.data(), GL_DYNAMIC_DRAW);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, vertexStorageBuffer);
+
+			//normals
+			glGenBuffers(1, &normalStorageBuffer);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, normalStorageBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, normalStorage.size() * sizeof(glm::vec4), normalStorage.data(), GL_DYNAMIC_DRAW);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, normalStorageBuffer);
+
+			glGenBuffers(1, &indexStorageBuffer);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexStorageBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_DYNAMIC_DRAW);
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, indexStorageBuffer);
 		}
-		glBufferData(GL_SHADER_STORAGE_BUFFER, normalStorage.size() * sizeof(glm::vec4), normalStorage.data(), GL_DYNAMIC_DRAW);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, normalStorageBuffer);
 
-		glGenBuffers(1, &indexStorageBuffer);
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexStorageBuffer);
-		glBufferData(GL_SHADER_STORAGE_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_DYNAMIC_DRAW);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, indexStorageBuffer);
+		//Vertex -> corner lists, so per vertex sums are gathered in a fixed order instead of scattered from faces
+		this->findAdjacentFaces();
 
-		//Curvature tensor elements for mid use
+		//Curvature tensor elements for mid use, one per corner
 		std::vector<GLfloat> curv1s, curv2s, curv12s;
-		curv1s.resize(vertices.size(),0.0f); curv2s.resize(vertices.size(), 0.0f); curv12s.resize(vertices.size(), 0.0f);
+		curv1s.resize(indices.size(), 0.0f); curv2s.resize(indices.size(), 0.0f); curv12s.resize(indices.size(), 0.0f);
 
 		GLuint curv1Buffer, curv2Buffer, curv12Buffer;
 		glGenBuffers(1, &curv1Buffer);
@@ -440,7 +812,7 @@ public:
 		glGenBuffers(1, &curv2Buffer);
 		glBindBuffer(GL_SHADER_STORAGE_BUFFER, curv2Buffer);
 		glBufferData(GL_SHADER_STORAGE_BUFFER, curv2s.size() * sizeof(GLfloat), curv2s.data(), GL_DYNAMIC_DRAW);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, curv2Buffer); glGenBuffers(1, &curv2Buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 13, curv2Buffer);
 
 		glGenBuffers(1, &curv12Buffer);
 		glBindBuffer(GL_SHADER_STORAGE_BUFFER, curv12Buffer);
@@ -450,6 +822,12 @@ public:
 		//Compute point areas
 		this->computePointAreas();
 
+		//Initial per vertex frames, read by the per face pass
+		glUseProgram(frames);
+		glUniform1ui(glGetUniformLocation(frames, "verticesSize"), this->numVertices);
+		glDispatchCompute(glm::ceil(GLfloat(this->numVertices) / float(workGroupSize)), 1, 1);
+		glMemoryBarrier(GL_ALL_BARRIER_BITS);
+
 		//Use first compute shader for curvature computation
 		glUseProgram(perFace);
 
@@ -500,6 +878,15 @@ public:
 
 		//is CUDA necessary?
 
+		//Mid use buffers and programs are only needed here
+		glDeleteBuffers(1, &curv1Buffer);
+		glDeleteBuffers(1, &curv2Buffer);
+		glDeleteBuffers(1, &curv12Buffer);
+		glDeleteProgram(frames);
+		glDeleteProgram(perFace);
+		glDeleteProgram(perVertex);
+
+		this->computeCurvatureDerivatives();
 		this->curvaturesCalculated = true;
 
 		auto end = std::chrono::high_resolution_clock::now();
@@ -516,44 +903,288 @@ public:
 		*/
 	}
 	
-	void computeHessian() {
+	//Recomputes curvatures after the host positions / normals of dirtyVertices changed, only around them.
+	//Rings around the edit : faces1 on the dirty vertices (corner areas), vertices1 of those (point areas, curvatures),
+	//faces2 on vertices1 (curvature tensors), vertices2 of those (curvature derivatives), faces3 on vertices2.
+	//vertices1 are refitted in their current principal directions rather than fresh frames (curvature_frames.compute),
+	//so results match computeCurvatures() up to rounding.
+	void updateCurvatures(const std::vector<uint32_t>& dirtyVertices) {
+		if (!this->isSet || !this->curvaturesCalculated || dirtyVertices.empty()) return;
+		auto start = std::chrono::high_resolution_clock::now();
+		this->rebindSSBOs();
+		this->downloadVertexCorners();
+		std::vector<uint32_t> faces1, vertices1, faces2, vertices2, faces3;
+		ringQuery.facesAround(vertexCorners, dirtyVertices, faces1);
+		ringQuery.verticesOf(vertexCorners, indices, faces1, vertices1);
+		ringQuery.facesAround(vertexCorners, vertices1, faces2);
+		ringQuery.verticesOf(vertexCorners, indices, faces2, vertices2);
+		ringQuery.facesAround(vertexCorners, vertices2, faces3);
+
+		if (!vertexUpdateCompute) {
+			vertexUpdateCompute = loadComputeShader(".\\shaders\\vertexUpdate.compute");
+			areaUpdateCompute[0] = loadComputeShader(".\\shaders\\pointAreas.compute");
+			areaUpdateCompute[1] = loadComputeShader(".\\shaders\\pointAreas_perVertex.compute");
+			curvatureUpdateCompute[0] = loadComputeShader(".\\shaders\\curvature_perFace.compute");
+			curvatureUpdateCompute[1] = loadComputeShader(".\\shaders\\curvature_perVertex.compute");
+			dcurvUpdateCompute[0] = loadComputeShader(".\\shaders\\dcurv_perFace.compute");
+			dcurvUpdateCompute[1] = loadComputeShader(".\\shaders\\dcurv_perVertex.compute");
+			for (int i = 0; i < 3; i++) cornerCurvBuffers[i] = createStorageBuffer(12 + i, std::max<size_t>(1, numIndices) * sizeof(GLfloat), nullptr);
+			cornerDcurvBuffer = createStorageBuffer(16, std::max<size_t>(1, numIndices) * sizeof(glm::vec4), nullptr);
+		}
+		for (int i = 0; i < 3; i++) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 12 + i, cornerCurvBuffers[i]);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 16, cornerDcurvBuffer);
+
+		//new positions / normals, into the SSBOs and the vertex attributes
+		std::vector<glm::vec4> updates(2 * dirtyVertices.size());
+		for (size_t i = 0; i < dirtyVertices.size(); i++) {
+			updates[2 * i] = glm::vec4(vertices[dirtyVertices[i]], 1.0f);
+			updates[2 * i + 1] = glm::vec4(normals[dirtyVertices[i]], 0.0f);
+		}
+		GLuint updateBuffer = createStorageBuffer(38, updates.size() * sizeof(glm::vec4), updates.data());
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 39, positionBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 40, normalBuffer);
+		this->dispatchList(vertexUpdateCompute, 37, dirtyVertices);
+		glDeleteBuffers(1, &updateBuffer);
+
+		this->dispatchList(areaUpdateCompute[0], 36, faces1);
+		this->dispatchList(areaUpdateCompute[1], 37, vertices1);
+		this->dispatchList(curvatureUpdateCompute[0], 36, faces2);
+		this->dispatchList(curvatureUpdateCompute[1], 37, vertices1);
+		this->dispatchList(dcurvUpdateCompute[0], 36, faces3);
+		this->dispatchList(dcurvUpdateCompute[1], 37, vertices2);
+
+		//vertex attribute copies of the PDs / curvatures, over the range of vertices that changed
+		const auto range = std::minmax_element(vertices1.begin(), vertices1.end());
+		const size_t first = *range.first, count = size_t(*range.second) - first + 1, nv = numVertices;
+		glCopyNamedBufferSubData(PDBuffer, maxPDVBO, first * sizeof(glm::vec4), first * sizeof(glm::vec4), count * sizeof(glm::vec4));
+		glCopyNamedBufferSubData(PDBuffer, minPDVBO, (nv + first) * sizeof(glm::vec4), first * sizeof(glm::vec4), count * sizeof(glm::vec4));
+		glCopyNamedBufferSubData(CurvatureBuffer, maxCurvVBO, first * sizeof(GLfloat), first * sizeof(GLfloat), count * sizeof(GLfloat));
+		glCopyNamedBufferSubData(CurvatureBuffer, minCurvVBO, (nv + first) * sizeof(GLfloat), first * sizeof(GLfloat), count * sizeof(GLfloat));
+		//bounds of the clusters with a moved vertex
+		std::vector<uint32_t> clusters(faces1.size());
+		for (size_t i = 0; i < faces1.size(); i++) clusters[i] = uint32_t(faces1[i] / meshClusters.facesPerCluster);
+		std::sort(clusters.begin(), clusters.end());
+		clusters.erase(std::unique(clusters.begin(), clusters.end()), clusters.end());
+		for (uint32_t c : clusters) {
+			MeshCluster& cluster = meshClusters.clusters[c];
+			fitMeshCluster(vertices, normals, indices, cluster);
+			glNamedBufferSubData(clusterBuffer, c * sizeof(MeshCluster), sizeof(MeshCluster), &cluster);
+		}
+		//host copies of the results are stale now, and so are the view dependent passes
+		this->hostArraysCurrent = false;
+		this->viewDependentInputs = 0;
 
+		auto end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> elapsed_seconds = end - start;
+		std::cout << "Curvatures for " << this->path << " updated around " << dirtyVertices.size() << " vertices (" << faces3.size() << " of "
+			<< numIndices / 3 << " faces). Took " << elapsed_seconds.count() << " seconds.\n";
 	}
-	//Finds adjacent vertices for each vertex
-	void findAdjacentFaces() {
+	//Vertex edit hook : moves vertices to positions, regenerates the normals of every vertex sharing a face with a moved
+	//one (regenerateVertexNormals(), weighted by normalWeighting) and updates the curvatures around those.
+	//Before uploadGL() only the host arrays change, the full pass then sees the new positions and normals.
+	void moveVertices(const std::vector<uint32_t>& ids, const std::vector<glm::vec3>& positions) {
+		if (ids.empty()) return;
+		this->edited = true;
+		for (size_t i = 0; i < ids.size(); i++) vertices[ids[i]] = positions[i];
+		if (this->isSet) this->downloadVertexCorners();
+		else if (vertexCorners.offsets.size() != vertices.size() + 1 || vertexCorners.corners.size() != indices.size())
+			buildVertexCorners(this->indices, this->vertices.size(), this->vertexCorners);
+		std::vector<uint32_t> faces, dirtyVertices;
+		ringQuery.facesAround(vertexCorners, ids, faces);
+		ringQuery.verticesOf(vertexCorners, indices, faces, dirtyVertices);
+		regenerateVertexNormals(this->vertices, this->indices, this->vertexCorners, dirtyVertices, this->normals, this->normalWeighting);
+		if (vertexStorage.size() == vertices.size() && normalStorage.size() == normals.size()) {
+			for (uint32_t v : dirtyVertices) {
+				vertexStorage[v] = glm::vec4(vertices[v], 1.0f);
+				normalStorage[v] = glm::vec4(normals[v], 0.0f);
+			}
+		}
+		this->updateCurvatures(dirtyVertices);
+	}
+	//Pushes the vertices within radius of vertex center out along their normals, height at the center falling off
+	//smoothly to 0 at radius. Returns the vertices moved.
+	std::vector<uint32_t> bumpVertices(uint32_t center, float radius, float height) {
+		std::vector<uint32_t> ids;
+		std::vector<glm::vec3> positions;
+		if (center >= vertices.size() || radius <= 0.0f) return ids;
+		const glm::vec3 origin = vertices[center];
+		for (uint32_t v = 0; v < vertices.size(); v++) {
+			const float t = glm::length(vertices[v] - origin) / radius;
+			if (t >= 1.0f) continue;
+			ids.push_back(v);
+			positions.push_back(vertices[v] + normals[v] * (height * (1.0f - t * t) * (1.0f - t * t)));
+		}
+		this->moveVertices(ids, positions);
+		return ids;
+	}
+	//Uploads list to binding (36 faces / 37 vertices) and runs program once per entry.
+	void dispatchList(GLuint program, GLuint binding, const std::vector<uint32_t>& list) {
+		if (list.empty()) return;
+		GLuint listBuffer = createStorageBuffer(binding, list.size() * sizeof(uint32_t), list.data());
+		glUseProgram(program);
+		glUniform1ui(glGetUniformLocation(program, "indicesSize"), this->numIndices);
+		glUniform1ui(glGetUniformLocation(program, "verticesSize"), this->numVertices);
+		glUniform1ui(glGetUniformLocation(program, "listSize"), GLuint(list.size()));
+		glDispatchCompute(glm::ceil(GLfloat(list.size()) / float(workGroupSize)), 1, 1);
+		glMemoryBarrier(GL_ALL_BARRIER_BITS);
+		glDeleteBuffers(1, &listBuffer);
+	}
+	//Derivative of the curvature tensor per vertex (binding 15), from the principal curvatures and directions.
+	//Per face fit -> per corner results -> gathered per vertex, like the curvatures.
+	void computeCurvatureDerivatives() {
 		auto start = std::chrono::high_resolution_clock::now();
-		this->adjacentFaces.resize(vertices.size()); //adjacentFaces<std::array<int, 20>
-		for (int i = 0; i < numVertices;i++) { adjacentFaces[i].fill(-1); }
-		/*
-		//Computing this on the cpu is rather slow so I made a shader for it.
-		*/
-		glGenBuffers(1, &adjacentFacesBuffer);
-		glBindBuffer(GL_SHADER_STORAGE_BUFFER, adjacentFacesBuffer);  
-		glBufferData(GL_SHADER_STORAGE_BUFFER, adjacentFaces.size() * sizeof(int) * 20, adjacentFaces.data(), GL_DYNAMIC_DRAW);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 20, adjacentFacesBuffer);
-
-		GLuint adjacentFacesCompute = loadComputeShader(".\\shaders\\adjacentFaces.compute");
-		glUseProgram(adjacentFacesCompute);
-		glUniform1ui(glGetUniformLocation(adjacentFacesCompute, "indicesSize"), this->numIndices);
-		glDispatchCompute(glm::ceil((GLfloat(this->numIndices) / 3.0f) / float(workGroupSize)), 1, 1); //per face
+		GLuint perFace = loadComputeShader(".\\shaders\\dcurv_perFace.compute");
+		GLuint perVertex = loadComputeShader(".\\shaders\\dcurv_perVertex.compute");
+
+		DCurvBuffer = createStorageBuffer(15, std::max<size_t>(1, this->numVertices) * sizeof(glm::vec4), nullptr);
+		//one per corner, only needed here
+		GLuint cornerDcurvBuffer = createStorageBuffer(16, std::max<size_t>(1, this->numIndices) * sizeof(glm::vec4), nullptr);
+
+		glUseProgram(perFace);
+		glUniform1ui(glGetUniformLocation(perFace, "indicesSize"), this->numIndices);
+		glUniform1ui(glGetUniformLocation(perFace, "verticesSize"), this->numVertices);
+		glDispatchCompute(glm::ceil((GLfloat(this->numIndices) / 3.0f) / float(workGroupSize)), 1, 1);
 		glMemoryBarrier(GL_ALL_BARRIER_BITS);
 
-		
+		glUseProgram(perVertex);
+		glUniform1ui(glGetUniformLocation(perVertex, "verticesSize"), this->numVertices);
+		glDispatchCompute(glm::ceil(GLfloat(this->numVertices) / float(workGroupSize)), 1, 1);
+		glMemoryBarrier(GL_ALL_BARRIER_BITS);
+
+		glDeleteBuffers(1, &cornerDcurvBuffer);
+		glDeleteProgram(perFace);
+		glDeleteProgram(perVertex);
+
 		auto end = std::chrono::high_resolution_clock::now();
 		std::chrono::duration<double> elapsed_seconds = end - start;
-		std::cout << "Adjacent faces calculated. Took : "<< elapsed_seconds.count() <<" seconds. \n";
+		std::cout << "Curvature derivatives for " << this->path << " calculated on compute shader. Took " << elapsed_seconds.count() << " seconds.\n";
+	}
+	//CPU copy of the vertex -> corner lists, read back if findAdjacentFaces() only built them on the GPU.
+	void downloadVertexCorners() {
+		if (vertexCorners.offsets.size() == size_t(numVertices) + 1 && vertexCorners.corners.size() == numIndices) return;
+		vertexCorners.offsets.resize(size_t(numVertices) + 1);
+		vertexCorners.corners.resize(numIndices);
+		glGetNamedBufferSubData(cornerOffsetBuffer, 0, vertexCorners.offsets.size() * sizeof(GLuint), vertexCorners.offsets.data());
+		glGetNamedBufferSubData(vertexCornerBuffer, 0, vertexCorners.corners.size() * sizeof(GLuint), vertexCorners.corners.data());
+	}
+	//Unique edges for the ridge extraction : edge ends (27) and every face's edges (29), built on the CPU from the
+	//vertex -> corner lists, plus the per vertex tmax (26) and per edge crossing (28) buffers the passes write
+	//and the candidate lists (41 - 46) sized for them.
+	void uploadMeshEdges() {
+		auto start = std::chrono::high_resolution_clock::now();
+		this->downloadVertexCorners();
+		MeshEdges edges;
+		buildMeshEdges(this->indices, this->vertexCorners, edges);
+		this->numEdges = GLuint(edges.size());
+		edgeBuffer = createStorageBuffer(27, std::max<size_t>(1, edges.vertices.size()) * sizeof(GLuint), edges.vertices.data());
+		faceEdgeBuffer = createStorageBuffer(29, std::max<size_t>(1, edges.faceEdges.size()) * sizeof(GLuint), edges.faceEdges.data());
+		ridgeVertexBuffer = createStorageBuffer(26, std::max<size_t>(1, this->numVertices) * sizeof(glm::vec4), nullptr);
+		edgePointBuffer = createStorageBuffer(28, std::max<size_t>(1, edges.size()) * sizeof(glm::vec4), nullptr);
+		//candidate lists (findRidgeCandidates()), marks start out unclaimed
+		const RidgeCandidateDispatch dispatch = { { 0, 1, 1 }, 0, { 0, 1, 1 }, 0, { 0, 1, 1 }, 0 };
+		ridgeDispatchBuffer = createStorageBuffer(41, sizeof(RidgeCandidateDispatch), &dispatch);
+		candidateVertexBuffer = createStorageBuffer(42, std::max<size_t>(1, this->numVertices) * sizeof(GLuint), nullptr);
+		candidateEdgeBuffer = createStorageBuffer(43, std::max<size_t>(1, edges.size()) * sizeof(GLuint), nullptr);
+		candidateFaceBuffer = createStorageBuffer(44, std::max<size_t>(1, this->numIndices / 3) * sizeof(GLuint), nullptr);
+		vertexMarkBuffer = createStorageBuffer(45, std::max<size_t>(1, this->numVertices) * sizeof(GLuint), nullptr);
+		edgeMarkBuffer = createStorageBuffer(46, std::max<size_t>(1, edges.size()) * sizeof(GLuint), nullptr);
+		glClearNamedBufferData(vertexMarkBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+		glClearNamedBufferData(edgeMarkBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+		this->candidateStamp = 0;
+		auto end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> elapsed_seconds = end - start;
+		std::cout << "Built " << this->numEdges << " unique edges for " << this->numIndices / 3 << " faces. Took " << elapsed_seconds.count() << " seconds.\n";
+	}
+	//Clusters for culling the per frame passes : bounds / normal cones (47) and vertex lists (48) built on the CPU,
+	//plus the visible lists (49 - 52) cullClusters() writes.
+	void uploadMeshClusters() {
+		auto start = std::chrono::high_resolution_clock::now();
+		this->downloadVertexCorners();
+		buildMeshClusters(this->vertices, this->normals, this->indices, this->vertexCorners, this->meshClusters);
+		const size_t clusterCount = this->meshClusters.size();
+		clusterBuffer = createStorageBuffer(47, std::max<size_t>(1, clusterCount) * sizeof(MeshCluster), meshClusters.clusters.data());
+		clusterVertexBuffer = createStorageBuffer(48, std::max<size_t>(1, meshClusters.vertices.size()) * sizeof(GLuint), meshClusters.vertices.data());
+		const VisibleClusterDispatch dispatch = { { 0, 1, 1 }, 0, { 0, 1, 1 }, 0 };
+		visibleDispatchBuffer = createStorageBuffer(49, sizeof(VisibleClusterDispatch), &dispatch);
+		visibleVertexBuffer = createStorageBuffer(50, std::max<size_t>(1, this->numVertices) * sizeof(GLuint), nullptr);
+		visibleFaceBuffer = createStorageBuffer(51, std::max<size_t>(1, this->numIndices / 3) * sizeof(GLuint), nullptr);
+		visibleMarkBuffer = createStorageBuffer(52, std::max<size_t>(1, this->numVertices) * sizeof(GLuint), nullptr);
+		glClearNamedBufferData(visibleMarkBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+		this->visibleStamp = 0;
+		auto end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> elapsed_seconds = end - start;
+		std::cout << "Built " << clusterCount << " clusters for " << this->numIndices / 3 << " faces. Took " << elapsed_seconds.count() << " seconds.\n";
+	}
+	//Finds adjacent faces for each vertex : the corners using it, as offsets (binding 32) into one packed list (binding 33).
+	//Corner c is on face c / 3, the opposite edge is the face's other two corners.
+	//Built with count -> prefix sum -> scatter passes and every list sorted, so it's the same on every run.
+	void findAdjacentFaces() {
+		auto start = std::chrono::high_resolution_clock::now();
+		const size_t nv = this->numVertices;
+		const size_t ni = this->numIndices;
+		//already built on the CPU by generateNormals()
+		const bool built = this->vertexCorners.offsets.size() == nv + 1 && this->vertexCorners.corners.size() == ni;
+		if (!this->adjacencyOnGPU || built) {
+			if (!built) buildVertexCorners(this->indices, nv, this->vertexCorners);
+			cornerOffsetBuffer = createStorageBuffer(32, (nv + 1) * sizeof(GLuint), vertexCorners.offsets.data());
+			vertexCornerBuffer = createStorageBuffer(33, std::max<size_t>(1, ni) * sizeof(GLuint), vertexCorners.corners.data());
+		}
+		else {
+			cornerOffsetBuffer = createStorageBuffer(32, (nv + 1) * sizeof(GLuint), nullptr);
+			glClearNamedBufferData(cornerOffsetBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+			vertexCornerBuffer = createStorageBuffer(33, std::max<size_t>(1, ni) * sizeof(GLuint), nullptr);
+			//scatter cursors and scan block totals, only needed here
+			const GLuint blockCount = GLuint((nv + 1 + 1023) / 1024);
+			GLuint cursorBuffer = createStorageBuffer(34, (nv + 1) * sizeof(GLuint), nullptr);
+			GLuint blockSumBuffer = createStorageBuffer(35, blockCount * sizeof(GLuint), nullptr);
+
+			GLuint count = loadComputeShader(".\\shaders\\vertexCorners_count.compute");
+			glUseProgram(count);
+			glUniform1ui(glGetUniformLocation(count, "indicesSize"), this->numIndices);
+			glDispatchCompute(glm::ceil(GLfloat(this->numIndices) / float(workGroupSize)), 1, 1); //per corner
+			glMemoryBarrier(GL_ALL_BARRIER_BITS);
+
+			//the scan shader's work groups are 1024 wide whatever workGroupSize is
+			GLuint scan = loadComputeShader(".\\shaders\\vertexCorners_scan.compute");
+			glUseProgram(scan);
+			glUniform1ui(glGetUniformLocation(scan, "scanSize"), GLuint(nv + 1));
+			glUniform1ui(glGetUniformLocation(scan, "blockCount"), blockCount);
+			const GLuint groups[3] = { blockCount, 1, blockCount };
+			for (GLuint pass = 0; pass < 3; pass++) {
+				glUniform1ui(glGetUniformLocation(scan, "scanPass"), pass);
+				glDispatchCompute(groups[pass], 1, 1);
+				glMemoryBarrier(GL_ALL_BARRIER_BITS);
+			}
+
+			GLuint scatter = loadComputeShader(".\\shaders\\vertexCorners_scatter.compute");
+			glUseProgram(scatter);
+			glUniform1ui(glGetUniformLocation(scatter, "indicesSize"), this->numIndices);
+			glDispatchCompute(glm::ceil(GLfloat(this->numIndices) / float(workGroupSize)), 1, 1); //per corner
+			glMemoryBarrier(GL_ALL_BARRIER_BITS);
 
-		glGetNamedBufferSubData(adjacentFacesBuffer, 0, adjacentFaces.size() * sizeof(GLfloat), adjacentFaces.data());
-		std::cout << "First vertex's adjacent vertices : ";
-		for (int j = 0; j < 10; j++) {
-			std::cout << this->adjacentFaces[0][2 * j] << ", " << this->adjacentFaces[0][2 * j + 1] << ". ";
+			GLuint sort = loadComputeShader(".\\shaders\\vertexCorners_sort.compute");
+			glUseProgram(sort);
+			glUniform1ui(glGetUniformLocation(sort, "verticesSize"), this->numVertices);
+			glDispatchCompute(glm::ceil(GLfloat(this->numVertices) / float(workGroupSize)), 1, 1); //per vertex
+			glMemoryBarrier(GL_ALL_BARRIER_BITS);
+
+			glDeleteBuffers(1, &cursorBuffer);
+			glDeleteBuffers(1, &blockSumBuffer);
+			glDeleteProgram(count);
+			glDeleteProgram(scan);
+			glDeleteProgram(scatter);
+			glDeleteProgram(sort);
 		}
-		std::cout << "\n";
+
+		auto end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> elapsed_seconds = end - start;
+		std::cout << "Adjacent faces calculated" << (this->adjacencyOnGPU ? " on compute shader" : "") << ". Took : " << elapsed_seconds.count() << " seconds. \n";
 	}
 	//Calculates pseudo-"Voronoi" area for each vertex
+	//Per face corner areas, then every vertex sums its corners (vertex -> corner lists at bindings 32 / 33).
 	void computePointAreas() {
-		pointAreaCompute = loadComputeShader(".\\shaders\\pointAreas.compute");
-		glUseProgram(pointAreaCompute);
+		GLuint perFace = loadComputeShader(".\\shaders\\pointAreas.compute");
+		glUseProgram(perFace);
 
 		pointAreas.resize(this->numVertices,0.0f); //by vertex
 		glGenBuffers(1, &pointAreaBuffer);
@@ -567,11 +1198,19 @@ public:
 		glBufferData(GL_SHADER_STORAGE_BUFFER, cornerAreas.size() * sizeof(GLfloat), cornerAreas.data(), GL_DYNAMIC_DRAW);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 31, cornerAreaBuffer);
 
-		glUniform1ui(glGetUniformLocation(pointAreaCompute, "indicesSize"), this->numIndices);
-		glUniform1ui(glGetUniformLocation(pointAreaCompute, "verticesSize"), this->numVertices);
+		glUniform1ui(glGetUniformLocation(perFace, "indicesSize"), this->numIndices);
+		glUniform1ui(glGetUniformLocation(perFace, "verticesSize"), this->numVertices);
 
 		glDispatchCompute(glm::ceil((GLfloat(this->numIndices) / 3.0f) / float(workGroupSize)), 1, 1);
 		glMemoryBarrier(GL_ALL_BARRIER_BITS);
+		glDeleteProgram(perFace);
+
+		GLuint perVertex = loadComputeShader(".\\shaders\\pointAreas_perVertex.compute");
+		glUseProgram(perVertex);
+		glUniform1ui(glGetUniformLocation(perVertex, "verticesSize"), this->numVertices);
+		glDispatchCompute(glm::ceil(GLfloat(this->numVertices) / float(workGroupSize)), 1, 1);
+		glMemoryBarrier(GL_ALL_BARRIER_BITS);
+		glDeleteProgram(perVertex);
 
 		/*
 		glGetNamedBufferSubData(cornerAreaBuffer, 0, cornerAreas.size() * sizeof(GLfloat), cornerAreas.data());
@@ -588,6 +1227,109 @@ public:
 		*/
 	
 	}
+	//Native loader where there is one, Assimp otherwise (or if the native loader gives up).
+	bool loadMesh() {
+		if (this->usesNativeLoader()) {
+			if (this->loadNative()) return true;
+			std::cout << "Native loader couldn't read " << this->path << ", falling back to Assimp.\n";
+			this->vertices.clear(); this->normals.clear(); this->indices.clear(); this->faces.clear(); this->subMeshes.clear();
+			this->useNativeLoaders = false;
+		}
+		return this->loadAssimp();
+	}
+	bool usesNativeLoader() const {
+		if (!this->useNativeLoaders) return false;
+		std::string extension = fileExtension(this->path);
+		return extension == "obj" || extension == "ply";
+	}
+	//Stored in the cache header, so a cache written from one loader is never used for another.
+	//Welding and reordering change the mesh too, so they're folded in.
+	unsigned int cacheImportKey() const {
+		unsigned int key = assimpImportFlags;
+		if (this->usesNativeLoader()) key = (fileExtension(this->path) == "obj") ? objLoaderCacheKey : plyLoaderCacheKey;
+		if (this->weldOnLoad) key ^= 0x9E3779B9u * (uint32_t(hashBytes(&this->weldTolerance, sizeof(float))) | 1u);
+		if (this->optimizeOnLoad) key ^= this->spaceFillingOrder ? 0x02000000u : 0x01000000u;
+		if (this->regenerateNormals) key ^= (this->normalWeighting == NORMALS_ANGLE) ? 0x08000000u : 0x04000000u;
+		return key;
+	}
+	//Merges duplicate and near coincident vertices (see weldVertices()), so faces share vertices for the curvature passes.
+	void weldMesh() {
+		auto start = std::chrono::high_resolution_clock::now();
+		const size_t before = this->vertices.size();
+		const float epsilon = this->weldTolerance * this->diagonalLength;
+		size_t merged = weldVertices(this->vertices, this->normals, &this->textureCoordinates, this->indices, &this->subMeshes, epsilon);
+		this->buildFaces();
+		this->numVertices = this->vertices.size();
+		this->numNormals = this->normals.size();
+		this->numFaces = this->faces.size();
+		this->numIndices = this->indices.size();
+		std::chrono::duration<double> elapsed_seconds = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "Welded " << merged << " of " << before << " vertices (epsilon " << epsilon << ") in " << this->path
+			<< ". Took " << elapsed_seconds.count() << " seconds.\n";
+	}
+	//Reorders triangles for the post transform cache (Tipsify), then vertices in first use order
+	//(or along a Morton curve with spaceFillingOrder).
+	//Both the draw and the per face compute passes read vertices in index order, so both get the locality.
+	void optimizeMesh() {
+		auto start = std::chrono::high_resolution_clock::now();
+		const VertexCacheStats before = vertexCacheStats(this->indices, this->vertices.size());
+		const double distanceBefore = meanEdgeIndexDistance(this->indices);
+		optimizeVertexCache(this->indices, this->vertices.size(), this->subMeshes);
+		if (this->spaceFillingOrder) reorderVerticesAlongCurve(this->vertices, this->normals, &this->textureCoordinates, this->indices);
+		else reorderVerticesByFirstUse(this->vertices, this->normals, &this->textureCoordinates, this->indices);
+		this->buildFaces();
+		const VertexCacheStats after = vertexCacheStats(this->indices, this->vertices.size());
+		const double distanceAfter = meanEdgeIndexDistance(this->indices);
+		std::chrono::duration<double> elapsed_seconds = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "Reordered " << this->path << " for a " << vertexCacheSize << " entry vertex cache. ACMR " << before.acmr << " -> " << after.acmr
+			<< ", ATVR " << before.atvr << " -> " << after.atvr << ". Took " << elapsed_seconds.count() << " seconds.\n";
+		std::cout << "Mean edge index distance (" << (this->spaceFillingOrder ? "Morton" : "first use") << " order) : "
+			<< distanceBefore << " -> " << distanceAfter << "\n";
+	}
+	//Replaces the normals with ones generated from the faces (generateVertexNormals()), weighted by normalWeighting.
+	//The vertex -> corner lists it needs are kept, findAdjacentFaces() uploads them instead of building them again.
+	void generateNormals() {
+		auto start = std::chrono::high_resolution_clock::now();
+		buildVertexCorners(this->indices, this->vertices.size(), this->vertexCorners);
+		generateVertexNormals(this->vertices, this->indices, this->vertexCorners, this->normals, this->normalWeighting);
+		this->numNormals = this->normals.size();
+		std::chrono::duration<double> elapsed_seconds = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "Generated " << normalWeightingName(this->normalWeighting) << " weighted normals for " << this->path << " ("
+			<< globalThreadPool().size() << " threads). Took " << elapsed_seconds.count() << " seconds.\n";
+	}
+	//faces from indices
+	void buildFaces() {
+		this->faces.resize(this->indices.size() / 3);
+		for (size_t i = 0; i < this->faces.size(); i++) {
+			this->faces[i] = { this->indices[3 * i], this->indices[3 * i + 1], this->indices[3 * i + 2] };
+		}
+	}
+	//Fills vertices / normals / indices / faces with ObjLoader.h or PlyLoader.h, no aiScene in between.
+	//sink gets the arrays as the loader finishes them (ingestMesh()).
+	bool loadNative(const MeshStreamSink* sink = nullptr) {
+		if (!this->vertices.empty()) {
+			return false; //if not empty return
+		}
+		auto start = std::chrono::high_resolution_clock::now();
+		const bool obj = (fileExtension(this->path) == "obj");
+		std::cout << "Loading file : " << this->path << (obj ? " (native OBJ).\n" : " (native PLY).\n");
+		bool ok = obj ? loadObj(this->path, this->vertices, this->normals, this->indices, sink)
+			: loadPly(this->path, this->vertices, this->normals, this->indices, sink);
+		if (!ok) return false;
+		this->subMeshes.assign(1, { 0, GLuint(this->indices.size()) });
+		this->buildFaces();
+		this->numVertices = this->vertices.size();
+		this->numNormals = this->normals.size();
+		this->numFaces = this->faces.size();
+		this->numIndices = this->indices.size();
+
+		auto end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> elapsed_seconds = end - start;
+		std::cout << "Number of vertices : " << this->vertices.size() << "\n";
+		std::cout << "Number of indices : " << this->indices.size() << "\n";
+		std::cout << "Parsed " << this->path << " in " << elapsed_seconds.count() << " seconds.\n";
+		return true;
+	}
 	bool loadAssimp() {
 		Assimp::Importer importer;
 		
@@ -597,61 +1339,27 @@ public:
 		
 		std::cout<<"Loading file : "<<this->path<<".\n";
 		//aiProcess_Triangulate !!!
-		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_JoinIdenticalVertices | aiProcess_CalcTangentSpace | aiProcess_GenUVCoords); //aiProcess_JoinIdenticalVertices | aiProcess_SortByPType);
+		const aiScene* scene = importer.ReadFile(path, assimpImportFlags);
 		if (!scene) {
 			fprintf(stderr, importer.GetErrorString());
 			return false;
 		}
 		std::cout << "Number of meshes : " << scene->mNumMeshes << ".\n";
 
-		// TODO : In this code we just use the 1st mesh (for now)
-		const aiMesh* mesh = scene->mMeshes[0];
-		// Fill vertices positions
-		//std::cout << "Number of vertices :" << mesh->mNumVertices << "\n";
-		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-			aiVector3D pos = mesh->mVertices[i];
-			this->vertices.push_back(glm::vec3(pos.x, pos.y, pos.z));
-		}
-
-		// Fill vertices texture coordinates
-		if (mesh->HasTextureCoords(0)) {
-			for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-				aiVector3D UVW = mesh->mTextureCoords[0][i]; // Assume only 1 set of UV coords; AssImp supports 8 UV sets.
-				this->textureCoordinates.push_back(glm::vec2(UVW.x, UVW.y));
-			}
-		}
-
-		// Fill vertices normals
-		if (mesh->HasNormals()) {
-			for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-				// std::cout<<"Number of Vertices : "<<mesh->mNumVertices<<"\n";
-				aiVector3D n = mesh->mNormals[i];
-				this->normals.push_back(glm::normalize(glm::vec3(n.x, n.y, n.z)));
-			}
-		}
-		else {
-			//std::cout << "Model has no normals.\n";
-			//mesh->
-			for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-				// std::cout<<"Number of Vertices : "<<mesh->mNumVertices<<"\n";
-				aiVector3D n = mesh->mNormals[i];
-				this->normals.push_back(glm::normalize(glm::vec3(n.x, n.y, n.z)));
-			}
-		}
-		// Fill face indices
-		for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-			std::array<unsigned int, 3> fac;
-			for (unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; j++) {
-				this->indices.push_back(mesh->mFaces[i].mIndices[j]);
-				fac[j] = mesh->mFaces[i].mIndices[j];
-			}
-			this->faces.push_back(fac);
+		//Every mesh goes into the same buffers so the curvature passes run once over the whole model
+		mergeAssimpScene(scene, this->vertices, this->normals, &this->textureCoordinates, this->indices, this->subMeshes);
+		if (this->vertices.size() < 3 || this->indices.empty()) {
+			std::cout << "No triangles in " << this->path << "\n";
+			return false;
 		}
+		if (!this->regenerateNormals) completeVertexNormals(this->vertices, this->indices, this->normals);
+		this->buildFaces();
 
 		std::cout << "Number of vertices : " << this->vertices.size() << "\n";
 		std::cout << "Number of normals : " << this->normals.size() << "\n";
 		std::cout << "Number of indices : " << this->indices.size() << "\n";
 		std::cout << "Number of faces : " << this->faces.size() << "\n";
+		std::cout << "Number of submeshes : " << this->subMeshes.size() << "\n";
 		
 		this->numVertices = this->vertices.size();
 		this->numNormals = this->normals.size();
@@ -663,6 +1371,410 @@ public:
 	}
 	bool exportAssimp() {
 
+	}
+	//Generates an SSBO, fills it and binds it to the given binding point.
+	GLuint createStorageBuffer(GLuint binding, size_t bytes, const void* data) {
+		GLuint buffer;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, data, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+		return buffer;
+	}
+	//Streams the vertex (9), normal (10) and index (11) SSBOs through the staging ring.
+	//A producer thread pads positions / normals to vec4 straight into the mapped slots while this thread
+	//copies finished slots into the SSBOs, so conversion and upload overlap and no vec4 copy of the mesh is kept.
+	void streamStorageBuffers() {
+		auto start = std::chrono::high_resolution_clock::now();
+		const size_t nv = numVertices;
+		const size_t ni = numIndices;
+		vertexStorageBuffer = createStorageBuffer(9, nv * sizeof(glm::vec4), nullptr);
+		normalStorageBuffer = createStorageBuffer(10, nv * sizeof(glm::vec4), nullptr);
+		indexStorageBuffer = createStorageBuffer(11, ni * sizeof(GLuint), nullptr);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		StagingRing& ring = stagingRing();
+		ring.begin();
+		//Own thread rather than the pool, which may be busy parsing other models while this thread waits on it.
+		std::future<void> producer = std::async(std::launch::async, [this, &ring, nv, ni] {
+			ring.stream(vertexStorageBuffer, nv, sizeof(glm::vec4), [this](unsigned char* dst, size_t first, size_t n) {
+				glm::vec4* out = reinterpret_cast<glm::vec4*>(dst);
+				for (size_t i = 0; i < n; i++) out[i] = glm::vec4(vertices[first + i], 1.0f);
+			});
+			ring.stream(normalStorageBuffer, nv, sizeof(glm::vec4), [this](unsigned char* dst, size_t first, size_t n) {
+				glm::vec4* out = reinterpret_cast<glm::vec4*>(dst);
+				for (size_t i = 0; i < n; i++) out[i] = glm::vec4(normals[first + i], 0.0f);
+			});
+			ring.stream(indexStorageBuffer, ni, sizeof(GLuint), [this](unsigned char* dst, size_t first, size_t n) {
+				std::memcpy(dst, indices.data() + first, n * sizeof(GLuint));
+			});
+			ring.close();
+		});
+		size_t bytes = ring.drain();
+		producer.get();
+
+		std::chrono::duration<double> elapsed_seconds = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "Streamed " << bytes / 1048576.0 << " MB of " << this->path << " through the staging ring. Took " << elapsed_seconds.count() << " seconds.\n";
+	}
+	//Streaming ingest, on the GL thread : the native loader runs on a producer thread and hands every chunk of positions
+	//and triangles to the staging ring as soon as it's parsed, while this thread copies finished slots into the SSBOs,
+	//so load time is close to max(parse, upload). Normals follow once they're complete (they're averaged over corners).
+	//Host memory is the parsed arrays, which the rest of the load still reads, plus the ring : no chunk copies, no vec4 copies.
+	//Falls back to loadMesh() / prepareMesh() if the ring isn't mapped or the native loader gives up.
+	bool ingestMesh() {
+		this->ingestPending = false;
+		StagingRing& ring = stagingRing();
+		if (ring.isMapped()) {
+			auto start = std::chrono::high_resolution_clock::now();
+			//the loader announces the array sizes on its thread, then waits here until the SSBOs exist
+			std::promise<std::pair<size_t, size_t>> sized;
+			std::future<std::pair<size_t, size_t>> sizes = sized.get_future();
+			std::promise<void> created;
+			std::shared_future<void> buffersReady = created.get_future().share();
+			MeshStreamSink sink;
+			sink.sizes = [&](size_t vertexCount, size_t indexCount) {
+				sized.set_value({ vertexCount, indexCount });
+				buffersReady.wait();
+			};
+			sink.positions = [&](const glm::vec3* data, size_t first, size_t count) {
+				ring.stream(vertexStorageBuffer, count, sizeof(glm::vec4), [data](unsigned char* dst, size_t f, size_t n) {
+					glm::vec4* out = reinterpret_cast<glm::vec4*>(dst);
+					for (size_t i = 0; i < n; i++) out[i] = glm::vec4(data[f + i], 1.0f);
+				}, first);
+			};
+			sink.normals = [&](const glm::vec3* data, size_t first, size_t count) {
+				ring.stream(normalStorageBuffer, count, sizeof(glm::vec4), [data](unsigned char* dst, size_t f, size_t n) {
+					glm::vec4* out = reinterpret_cast<glm::vec4*>(dst);
+					for (size_t i = 0; i < n; i++) out[i] = glm::vec4(data[f + i], 0.0f);
+				}, first);
+			};
+			sink.indices = [&](const unsigned int* data, size_t first, size_t count) {
+				ring.stream(indexStorageBuffer, count, sizeof(GLuint), [data](unsigned char* dst, size_t f, size_t n) {
+					std::memcpy(dst, data + f, n * sizeof(GLuint));
+				}, first);
+			};
+			ring.begin();
+			//Own thread rather than the pool, the loader runs its chunks on the pool.
+			std::future<bool> producer = std::async(std::launch::async, [this, &ring, &sink] {
+				const bool ok = this->loadNative(&sink);
+				ring.close();
+				return ok;
+			});
+			//sizes come before the first chunk, unless the loader gives up first
+			while (sizes.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready
+				&& producer.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {}
+			size_t bytes = 0;
+			if (sizes.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				const std::pair<size_t, size_t> count = sizes.get();
+				vertexStorageBuffer = createStorageBuffer(9, count.first * sizeof(glm::vec4), nullptr);
+				normalStorageBuffer = createStorageBuffer(10, count.first * sizeof(glm::vec4), nullptr);
+				indexStorageBuffer = createStorageBuffer(11, count.second * sizeof(GLuint), nullptr);
+				glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+				created.set_value();
+				bytes = ring.drain();
+			}
+			if (producer.get()) {
+				this->prepareMesh(false);
+				std::chrono::duration<double> elapsed_seconds = std::chrono::high_resolution_clock::now() - start;
+				std::cout << "Parsed and streamed " << bytes / 1048576.0 << " MB of " << this->path << " through the staging ring. Took "
+					<< elapsed_seconds.count() << " seconds.\n";
+				return true;
+			}
+			ring.drain();
+			GLuint* buffers[] = { &vertexStorageBuffer, &normalStorageBuffer, &indexStorageBuffer };
+			for (GLuint* buffer : buffers) {
+				glDeleteBuffers(1, buffer);
+				*buffer = 0;
+			}
+			std::cout << "Native loader couldn't read " << this->path << ", falling back to Assimp.\n";
+			this->vertices.clear(); this->normals.clear(); this->indices.clear(); this->faces.clear(); this->subMeshes.clear();
+			this->useNativeLoaders = false;
+		}
+		if (!this->loadMesh()) { std::cout << "Model at " << path << " not loaded!\n"; return false; }
+		this->prepareMesh(false);
+		return true;
+	}
+	//SSBOs need vec4s, so pad positions and normals once here.
+	void buildStorageArrays() {
+		vertexStorage.resize(vertices.size());
+		normalStorage.resize(normals.size());
+		for (size_t i = 0; i < vertices.size(); i++) vertexStorage[i] = glm::vec4(vertices[i], 1.0f);
+		for (size_t i = 0; i < normals.size(); i++) normalStorage[i] = glm::vec4(normals[i], 0.0f);
+	}
+	//Loads mesh, curvatures and adjacency from <path>.arcache if it matches the source file's content.
+	//The mapping stays open until uploadCache() fills the SSBOs straight from it.
+	bool loadCache() {
+		auto start = std::chrono::high_resolution_clock::now();
+		{
+			MappedFile source(this->path);
+			if (!source.isOpen()) return false;
+			this->sourceHash = hashBytes(source.data(), source.size());
+			this->sourceSize = source.size();
+		}
+		std::shared_ptr<MeshCache> cachePtr = std::make_shared<MeshCache>();
+		MeshCache& cache = *cachePtr;
+		if (!cache.open(meshCachePath(this->path), this->sourceHash, this->sourceSize, this->cacheImportKey())) return false;
+
+		const size_t nv = cache.header.numVertices;
+		const size_t ni = cache.header.numIndices;
+		const glm::vec4* cachedPositions = static_cast<const glm::vec4*>(cache.section(CACHE_POSITIONS, nv * sizeof(glm::vec4)));
+		const glm::vec4* cachedNormals = static_cast<const glm::vec4*>(cache.section(CACHE_NORMALS, nv * sizeof(glm::vec4)));
+		const GLuint* cachedIndices = static_cast<const GLuint*>(cache.section(CACHE_INDICES, ni * sizeof(GLuint)));
+		const GLfloat* cachedPointAreas = static_cast<const GLfloat*>(cache.section(CACHE_POINT_AREAS, nv * sizeof(GLfloat)));
+		const GLfloat* cachedCornerAreas = static_cast<const GLfloat*>(cache.section(CACHE_CORNER_AREAS, ni * sizeof(GLfloat)));
+		const glm::vec4* cachedPDs = static_cast<const glm::vec4*>(cache.section(CACHE_PDS, 2 * nv * sizeof(glm::vec4)));
+		const GLfloat* cachedCurvatures = static_cast<const GLfloat*>(cache.section(CACHE_CURVATURES, 2 * nv * sizeof(GLfloat)));
+		const glm::vec4* cachedDcurvs = static_cast<const glm::vec4*>(cache.section(CACHE_DCURVS, nv * sizeof(glm::vec4)));
+		const uint32_t* cachedCornerOffsets = static_cast<const uint32_t*>(cache.section(CACHE_CORNER_OFFSETS, (nv + 1) * sizeof(uint32_t)));
+		const uint32_t* cachedVertexCorners = static_cast<const uint32_t*>(cache.section(CACHE_VERTEX_CORNERS, ni * sizeof(uint32_t)));
+		if (!cachedPositions || !cachedNormals || !cachedIndices || !cachedPointAreas || !cachedCornerAreas
+			|| !cachedPDs || !cachedCurvatures || !cachedDcurvs || !cachedCornerOffsets || !cachedVertexCorners || nv < 2 || ni % 3 != 0) {
+			std::cout << "Cache for " << this->path << " is incomplete, rebuilding.\n";
+			return false;
+		}
+
+		//CPU side copies
+		this->vertices.resize(nv);
+		this->normals.resize(nv);
+		for (size_t i = 0; i < nv; i++) {
+			this->vertices[i] = glm::vec3(cachedPositions[i]);
+			this->normals[i] = glm::vec3(cachedNormals[i]);
+		}
+		this->indices.assign(cachedIndices, cachedIndices + ni);
+		this->faces.resize(ni / 3);
+		for (size_t i = 0; i < ni / 3; i++) {
+			this->faces[i] = { cachedIndices[3 * i], cachedIndices[3 * i + 1], cachedIndices[3 * i + 2] };
+		}
+		this->pointAreas.assign(cachedPointAreas, cachedPointAreas + nv);
+		this->cornerAreas.assign(cachedCornerAreas, cachedCornerAreas + ni);
+		this->PDs.assign(cachedPDs, cachedPDs + 2 * nv);
+		this->PrincipalCurvatures.assign(cachedCurvatures, cachedCurvatures + 2 * nv);
+		this->dcurvs.assign(cachedDcurvs, cachedDcurvs + nv);
+		this->vertexCorners.offsets.assign(cachedCornerOffsets, cachedCornerOffsets + nv + 1);
+		this->vertexCorners.corners.assign(cachedVertexCorners, cachedVertexCorners + ni);
+		const size_t subMeshBytes = cache.sectionBytes(CACHE_SUBMESHES);
+		const SubMesh* cachedSubMeshes = static_cast<const SubMesh*>(cache.section(CACHE_SUBMESHES, subMeshBytes));
+		if (cachedSubMeshes && subMeshBytes % sizeof(SubMesh) == 0) this->subMeshes.assign(cachedSubMeshes, cachedSubMeshes + subMeshBytes / sizeof(SubMesh));
+		else this->subMeshes.assign(1, { 0, GLuint(ni) });
+
+		this->numVertices = nv;
+		this->numNormals = nv;
+		this->numFaces = ni / 3;
+		this->numIndices = ni;
+
+		this->mappedCache = cachePtr;
+		this->loadedFromCache = true;
+		this->hostArraysCurrent = true;
+
+		auto end = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> elapsed_seconds = end - start;
+		std::cout << "Loaded " << this->path << " from cache (" << nv << " vertices, " << ni / 3 << " faces). Took " << elapsed_seconds.count() << " seconds.\n";
+		return true;
+	}
+	//Fills the SSBOs straight from the mapped cache, then unmaps it.
+	void uploadCache() {
+		const MeshCache& cache = *this->mappedCache;
+		const size_t nv = numVertices;
+		const size_t ni = numIndices;
+		//SSBOs, same bindings as computeCurvatures() / findAdjacentFaces()
+		PDBuffer = createStorageBuffer(7, 2 * nv * sizeof(glm::vec4), cache.section(CACHE_PDS, 2 * nv * sizeof(glm::vec4)));
+		CurvatureBuffer = createStorageBuffer(8, 2 * nv * sizeof(GLfloat), cache.section(CACHE_CURVATURES, 2 * nv * sizeof(GLfloat)));
+		DCurvBuffer = createStorageBuffer(15, nv * sizeof(glm::vec4), cache.section(CACHE_DCURVS, nv * sizeof(glm::vec4)));
+		vertexStorageBuffer = createStorageBuffer(9, nv * sizeof(glm::vec4), cache.section(CACHE_POSITIONS, nv * sizeof(glm::vec4)));
+		normalStorageBuffer = createStorageBuffer(10, nv * sizeof(glm::vec4), cache.section(CACHE_NORMALS, nv * sizeof(glm::vec4)));
+		indexStorageBuffer = createStorageBuffer(11, ni * sizeof(GLuint), cache.section(CACHE_INDICES, ni * sizeof(GLuint)));
+		cornerOffsetBuffer = createStorageBuffer(32, (nv + 1) * sizeof(GLuint), cache.section(CACHE_CORNER_OFFSETS, (nv + 1) * sizeof(GLuint)));
+		vertexCornerBuffer = createStorageBuffer(33, std::max<size_t>(1, ni) * sizeof(GLuint), cache.section(CACHE_VERTEX_CORNERS, ni * sizeof(GLuint)));
+		pointAreaBuffer = createStorageBuffer(30, nv * sizeof(GLfloat), cache.section(CACHE_POINT_AREAS, nv * sizeof(GLfloat)));
+		cornerAreaBuffer = createStorageBuffer(31, ni * sizeof(GLfloat), cache.section(CACHE_CORNER_AREAS, ni * sizeof(GLfloat)));
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		this->mappedCache.reset();
+		this->curvaturesCalculated = true;
+	}
+	//Same as uploadCache() but from the host arrays.
+	void uploadHostArrays() {
+		const size_t nv = numVertices;
+		const size_t ni = numIndices;
+		PDBuffer = createStorageBuffer(7, 2 * nv * sizeof(glm::vec4), PDs.data());
+		CurvatureBuffer = createStorageBuffer(8, 2 * nv * sizeof(GLfloat), PrincipalCurvatures.data());
+		DCurvBuffer = createStorageBuffer(15, nv * sizeof(glm::vec4), dcurvs.data());
+		if (this->streamUploads && stagingRing().isMapped()) this->streamStorageBuffers();
+		else {
+			this->buildStorageArrays();
+			vertexStorageBuffer = createStorageBuffer(9, nv * sizeof(glm::vec4), vertexStorage.data());
+			normalStorageBuffer = createStorageBuffer(10, nv * sizeof(glm::vec4), normalStorage.data());
+			indexStorageBuffer = createStorageBuffer(11, ni * sizeof(GLuint), indices.data());
+		}
+		cornerOffsetBuffer = createStorageBuffer(32, (nv + 1) * sizeof(GLuint), vertexCorners.offsets.data());
+		vertexCornerBuffer = createStorageBuffer(33, std::max<size_t>(1, ni) * sizeof(GLuint), vertexCorners.corners.data());
+		pointAreaBuffer = createStorageBuffer(30, nv * sizeof(GLfloat), pointAreas.data());
+		cornerAreaBuffer = createStorageBuffer(31, ni * sizeof(GLfloat), cornerAreas.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		this->curvaturesCalculated = true;
+	}
+	//Pulls every load time result back from the SSBOs into the host arrays.
+	void readBackComputed() {
+		PDs.resize(2 * numVertices);
+		PrincipalCurvatures.resize(2 * numVertices);
+		dcurvs.resize(numVertices);
+		pointAreas.resize(numVertices);
+		cornerAreas.resize(numIndices);
+		vertexCorners.offsets.resize(numVertices + 1);
+		vertexCorners.corners.resize(numIndices);
+		glGetNamedBufferSubData(PDBuffer, 0, PDs.size() * sizeof(glm::vec4), PDs.data());
+		glGetNamedBufferSubData(CurvatureBuffer, 0, PrincipalCurvatures.size() * sizeof(GLfloat), PrincipalCurvatures.data());
+		glGetNamedBufferSubData(DCurvBuffer, 0, dcurvs.size() * sizeof(glm::vec4), dcurvs.data());
+		glGetNamedBufferSubData(pointAreaBuffer, 0, pointAreas.size() * sizeof(GLfloat), pointAreas.data());
+		glGetNamedBufferSubData(cornerAreaBuffer, 0, cornerAreas.size() * sizeof(GLfloat), cornerAreas.data());
+		glGetNamedBufferSubData(cornerOffsetBuffer, 0, vertexCorners.offsets.size() * sizeof(GLuint), vertexCorners.offsets.data());
+		glGetNamedBufferSubData(vertexCornerBuffer, 0, vertexCorners.corners.size() * sizeof(GLuint), vertexCorners.corners.data());
+		this->hostArraysCurrent = true;
+	}
+	//Deletes every GL object the model owns. The host arrays are kept (read back first if needed)
+	//so uploadGL() can make it resident again without recomputing anything.
+	void releaseGL() {
+		if (!this->isSet) return;
+		this->viewDependentInputs = 0;
+		if (!this->hostArraysCurrent) this->readBackComputed();
+		//names are zeroed once deleted, GL may hand them out again to other models
+		GLuint* buffers[] = {
+			&positionBuffer, &normalBuffer, &textureBuffer, &EBO,
+			&maxPDVBO, &minPDVBO, &maxCurvVBO, &minCurvVBO,
+			&PDBuffer, &CurvatureBuffer, &DCurvBuffer, &vertexStorageBuffer, &normalStorageBuffer, &indexStorageBuffer,
+			&q1Buffer, &t1Buffer, &Dt1q1Buffer, &pointAreaBuffer, &cornerAreaBuffer, &cornerOffsetBuffer, &vertexCornerBuffer, &indirectBuffer,
+			&ridgeSegmentBuffer, &ridgeCommandBuffer, &edgeBuffer, &faceEdgeBuffer, &ridgeVertexBuffer, &edgePointBuffer,
+			&ridgeDispatchBuffer, &candidateVertexBuffer, &candidateEdgeBuffer, &candidateFaceBuffer, &vertexMarkBuffer, &edgeMarkBuffer,
+			&clusterBuffer, &clusterVertexBuffer, &visibleDispatchBuffer, &visibleVertexBuffer, &visibleFaceBuffer, &visibleMarkBuffer
+		};
+		for (GLuint* buffer : buffers) {
+			glDeleteBuffers(1, buffer);
+			*buffer = 0;
+		}
+		glDeleteVertexArrays(1, &VAO);
+		VAO = 0;
+		GLuint* programs[] = {
+			&viewDepCurvatureCompute, &Dt1q1Compute, &ridgeCandidateCompute, &clusterCullCompute,
+			&ridgeVertexCompute, &ridgeEdgeCompute, &ridgeExtractionCompute
+		};
+		for (GLuint* program : programs) {
+			glDeleteProgram(*program);
+			*program = 0;
+		}
+		if (vertexUpdateCompute) {
+			GLuint programs[] = { vertexUpdateCompute, areaUpdateCompute[0], areaUpdateCompute[1], curvatureUpdateCompute[0], curvatureUpdateCompute[1],
+				dcurvUpdateCompute[0], dcurvUpdateCompute[1] };
+			for (GLuint program : programs) glDeleteProgram(program);
+			glDeleteBuffers(3, cornerCurvBuffers);
+			glDeleteBuffers(1, &cornerDcurvBuffer);
+			vertexUpdateCompute = 0;
+			for (int i = 0; i < 2; i++) areaUpdateCompute[i] = curvatureUpdateCompute[i] = dcurvUpdateCompute[i] = 0;
+			for (GLuint& buffer : cornerCurvBuffers) buffer = 0;
+			cornerDcurvBuffer = 0;
+		}
+		this->isSet = false;
+		this->curvaturesCalculated = false;
+	}
+	//Drops the host copies too. Only valid once the model is not resident on the GPU;
+	//loadCPU() brings it back (from the cache file if there is one), so edited models keep theirs.
+	void releaseHost() {
+		if (this->isSet) return;
+		if (this->edited) {
+			std::cout << "Keeping host arrays of " << this->path << " : it was edited, reloading would lose the edits.\n";
+			return;
+		}
+		std::vector<glm::vec3>().swap(vertices);
+		std::vector<glm::vec3>().swap(normals);
+		std::vector<std::array<unsigned int, 3>>().swap(faces);
+		std::vector<glm::vec2>().swap(textureCoordinates);
+		std::vector<glm::vec3>().swap(tangents);
+		std::vector<glm::vec3>().swap(bitangents);
+		std::vector<GLuint>().swap(indices);
+		std::vector<SubMesh>().swap(subMeshes);
+		std::vector<glm::vec4>().swap(PDs);
+		std::vector<GLfloat>().swap(PrincipalCurvatures);
+		std::vector<glm::vec4>().swap(dcurvs);
+		std::vector<uint32_t>().swap(vertexCorners.offsets);
+		std::vector<uint32_t>().swap(vertexCorners.corners);
+		std::vector<GLfloat>().swap(pointAreas);
+		std::vector<GLfloat>().swap(cornerAreas);
+		std::vector<float>().swap(q1s);
+		std::vector<glm::vec2>().swap(t1s);
+		std::vector<float>().swap(Dt1q1s);
+		std::vector<glm::vec4>().swap(vertexStorage);
+		std::vector<glm::vec4>().swap(normalStorage);
+		std::vector<MeshCluster>().swap(meshClusters.clusters);
+		std::vector<uint32_t>().swap(meshClusters.vertices);
+		std::vector<uint32_t>().swap(ringQuery.faceStamp);
+		std::vector<uint32_t>().swap(ringQuery.vertexStamp);
+		this->mappedCache.reset();
+		this->loaded = false;
+		this->loadedFromCache = false;
+		this->hostArraysCurrent = false;
+	}
+	//Approximate VRAM used while resident, from the sizes setup() / computeCurvatures() allocate.
+	size_t gpuBytes() const {
+		size_t perVertex = 2 * sizeof(glm::vec3)    //position, normal VBOs
+			+ 2 * sizeof(glm::vec4) + 2 * sizeof(GLfloat)  //PD / curvature VBOs
+			+ 2 * sizeof(glm::vec4)                     //vertex, normal SSBOs
+			+ 2 * sizeof(glm::vec4) + 2 * sizeof(GLfloat)  //PD / curvature SSBOs
+			+ sizeof(glm::vec4)                         //curvature derivatives
+			+ sizeof(GLuint)                            //corner list offsets
+			+ sizeof(GLfloat) + sizeof(glm::vec2) + sizeof(GLfloat) //q1, t1, Dt1q1
+			+ sizeof(GLfloat);                          //point areas
+		size_t perIndex = sizeof(GLuint) * 3 + sizeof(GLfloat); //EBO, index SSBO, corner list, corner areas
+		if (vertexUpdateCompute) perIndex += 3 * sizeof(GLfloat) + sizeof(glm::vec4); //updateCurvatures() per corner buffers
+		const size_t numFaces = numIndices / 3;
+		size_t bytes = size_t(numVertices) * perVertex + size_t(numIndices) * perIndex + subMeshes.size() * sizeof(DrawElementsIndirectCommand);
+		bytes += numFaces * 6 * sizeof(glm::vec4) + sizeof(DrawArraysIndirectCommand); //ridge segments and their draw command
+		bytes += size_t(numVertices) * sizeof(glm::vec4); //ridge passes' per vertex tmax
+		bytes += size_t(numEdges) * (2 * sizeof(GLuint) + sizeof(glm::vec4)) + numFaces * 3 * sizeof(GLuint); //edge ends and crossings, face edges
+		bytes += sizeof(RidgeCandidateDispatch) + (2 * size_t(numVertices) + 2 * size_t(numEdges) + numFaces) * sizeof(GLuint); //ridge candidate lists and marks
+		bytes += meshClusters.clusters.size() * sizeof(MeshCluster) + meshClusters.vertices.size() * sizeof(GLuint); //clusters
+		bytes += sizeof(VisibleClusterDispatch) + (2 * size_t(numVertices) + numFaces) * sizeof(GLuint); //visible lists and marks
+		return bytes;
+	}
+	//Host memory held by the model's arrays.
+	size_t hostBytes() const {
+		return vertices.capacity() * sizeof(glm::vec3) + normals.capacity() * sizeof(glm::vec3)
+			+ faces.capacity() * sizeof(std::array<unsigned int, 3>) + textureCoordinates.capacity() * sizeof(glm::vec2)
+			+ indices.capacity() * sizeof(GLuint) + PDs.capacity() * sizeof(glm::vec4)
+			+ PrincipalCurvatures.capacity() * sizeof(GLfloat) + dcurvs.capacity() * sizeof(glm::vec4) + (vertexCorners.offsets.capacity() + vertexCorners.corners.capacity()) * sizeof(uint32_t)
+			+ pointAreas.capacity() * sizeof(GLfloat) + cornerAreas.capacity() * sizeof(GLfloat)
+			+ q1s.capacity() * sizeof(float) + t1s.capacity() * sizeof(glm::vec2) + Dt1q1s.capacity() * sizeof(float)
+			+ vertexStorage.capacity() * sizeof(glm::vec4) + normalStorage.capacity() * sizeof(glm::vec4)
+			+ meshClusters.clusters.capacity() * sizeof(MeshCluster) + meshClusters.vertices.capacity() * sizeof(uint32_t)
+			+ (ringQuery.faceStamp.capacity() + ringQuery.vertexStamp.capacity()) * sizeof(uint32_t);
+	}
+	//Reads back everything computed at load time and writes it to <path>.arcache.
+	bool writeCache() {
+		if (this->sourceSize == 0) {
+			MappedFile source(this->path);
+			if (!source.isOpen()) return false;
+			this->sourceHash = hashBytes(source.data(), source.size());
+			this->sourceSize = source.size();
+		}
+		if (vertexStorage.size() != vertices.size()) this->buildStorageArrays();
+		if (!hostArraysCurrent) this->readBackComputed();
+
+		std::vector<MeshCacheBlob> blobs = {
+			{ CACHE_POSITIONS, vertexStorage.data(), vertexStorage.size() * sizeof(glm::vec4) },
+			{ CACHE_NORMALS, normalStorage.data(), normalStorage.size() * sizeof(glm::vec4) },
+			{ CACHE_INDICES, indices.data(), indices.size() * sizeof(GLuint) },
+			{ CACHE_POINT_AREAS, pointAreas.data(), pointAreas.size() * sizeof(GLfloat) },
+			{ CACHE_CORNER_AREAS, cornerAreas.data(), cornerAreas.size() * sizeof(GLfloat) },
+			{ CACHE_PDS, PDs.data(), PDs.size() * sizeof(glm::vec4) },
+			{ CACHE_CURVATURES, PrincipalCurvatures.data(), PrincipalCurvatures.size() * sizeof(GLfloat) },
+			{ CACHE_DCURVS, dcurvs.data(), dcurvs.size() * sizeof(glm::vec4) },
+			{ CACHE_CORNER_OFFSETS, vertexCorners.offsets.data(), vertexCorners.offsets.size() * sizeof(uint32_t) },
+			{ CACHE_VERTEX_CORNERS, vertexCorners.corners.data(), vertexCorners.corners.size() * sizeof(uint32_t) },
+			{ CACHE_SUBMESHES, subMeshes.data(), subMeshes.size() * sizeof(SubMesh) },
+		};
+		if (!writeMeshCache(meshCachePath(this->path), this->sourceHash, this->sourceSize, this->cacheImportKey(), numVertices, numIndices, blobs)) {
+			std::cout << "Failed to write cache for " << this->path << "\n";
+			return false;
+		}
+		std::cout << "Wrote cache " << meshCachePath(this->path) << "\n";
+		return true;
 	}
 	bool rebindSSBOs() {
 
@@ -672,12 +1784,32 @@ public:
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, vertexStorageBuffer);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, normalStorageBuffer);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, indexStorageBuffer);
-		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 20, adjacentFacesBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 15, DCurvBuffer);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 21, q1Buffer);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 22, t1Buffer);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 23, Dt1q1Buffer);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 30, pointAreaBuffer);
 		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 31, cornerAreaBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 32, cornerOffsetBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 33, vertexCornerBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 24, ridgeSegmentBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 25, ridgeCommandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 26, ridgeVertexBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 27, edgeBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 28, edgePointBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 29, faceEdgeBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 41, ridgeDispatchBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 42, candidateVertexBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 43, candidateEdgeBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 44, candidateFaceBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 45, vertexMarkBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 46, edgeMarkBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 47, clusterBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 48, clusterVertexBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 49, visibleDispatchBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 50, visibleVertexBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 51, visibleFaceBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 52, visibleMarkBuffer);
 		return true;
 	}
 
@@ -694,10 +1826,12 @@ public:
 		glDeleteBuffers(1, &EBO);
 		glDeleteBuffers(1, &PDBuffer);
 		glDeleteBuffers(1, &CurvatureBuffer);
+		glDeleteBuffers(1, &DCurvBuffer);
 		glDeleteBuffers(1, &vertexStorageBuffer);
 		glDeleteBuffers(1, &normalStorageBuffer);
 		glDeleteBuffers(1, &indexStorageBuffer);
-		glDeleteBuffers(1, &adjacentFacesBuffer);
+		glDeleteBuffers(1, &cornerOffsetBuffer);
+		glDeleteBuffers(1, &vertexCornerBuffer);
 		glDeleteBuffers(1, &q1Buffer);
 		glDeleteBuffers(1, &t1Buffer);
 		glDeleteBuffers(1, &Dt1q1Buffer);
@@ -722,58 +1856,239 @@ bool loadAssimp(
 	Assimp::Importer importer;
 	printf("Loading file : %s...\n", path);
 	//aiProcess_Triangulate !!!
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals| aiProcess_JoinIdenticalVertices| aiProcess_CalcTangentSpace |aiProcess_GenUVCoords ); //aiProcess_JoinIdenticalVertices | aiProcess_SortByPType);
+	const aiScene* scene = importer.ReadFile(path, assimpImportFlags);
 	if (!scene) {
 		fprintf(stderr, importer.GetErrorString());
 		return false;
 	}
-	// TODO : In this code we just use the 1st mesh (for now)
-	const aiMesh* mesh = scene->mMeshes[0]; 
-	// Fill vertices positions
-	//std::cout << "Number of vertices :" << mesh->mNumVertices << "\n";
-	for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-		aiVector3D pos = mesh->mVertices[i];
-		out_vertices.push_back(glm::vec3(pos.x, pos.y, pos.z));
-	}
+	std::vector<SubMesh> subMeshes;
+	mergeAssimpScene(scene, out_vertices, out_normals, &uvs, out_indices, subMeshes);
+	completeVertexNormals(out_vertices, out_indices, out_normals);
 
-	// Fill vertices texture coordinates
-	if (mesh->HasTextureCoords(0)) {
-		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-			aiVector3D UVW = mesh->mTextureCoords[0][i]; // Assume only 1 set of UV coords; AssImp supports 8 UV sets.
-			uvs.push_back(glm::vec2(UVW.x, UVW.y));
-		}
+	std::cout << "Size of vertices : " << out_vertices.size() << "\n";
+	std::cout << "Size of normals : " << out_normals.size() << "\n";
+	std::cout << "Size of indices : " << out_indices.size() << "\n";
+
+
+	// The "scene" pointer will be deleted automatically by "importer"
+	return true;
+}
+
+//Times the native OBJ loader against the Assimp import Model would otherwise run and prints MB/s for both.
+void benchmarkObjLoader(const std::string& path, int runs = 3) {
+	MappedFile file(path);
+	if (!file.isOpen()) { std::cout << "Benchmark : can't open " << path << "\n"; return; }
+	const double megabytes = file.size() / 1048576.0;
+	file.close();
+	double nativeBest = 1e30, assimpBest = 1e30;
+	size_t nativeVertices = 0, assimpVertices = 0;
+	for (int run = 0; run < runs; run++) {
+		std::vector<glm::vec3> v, n;
+		std::vector<unsigned int> i;
+		auto start = std::chrono::high_resolution_clock::now();
+		bool ok = loadObj(path, v, n, i);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		if (!ok) { std::cout << "Benchmark : native loader failed on " << path << "\n"; return; }
+		nativeBest = std::min(nativeBest, elapsed.count());
+		nativeVertices = v.size();
+	}
+	for (int run = 0; run < runs; run++) {
+		std::vector<glm::vec3> v, n;
+		std::vector<unsigned int> i;
+		auto start = std::chrono::high_resolution_clock::now();
+		bool ok = loadAssimp(path.c_str(), v, n, i);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		if (!ok) break;
+		assimpBest = std::min(assimpBest, elapsed.count());
+		assimpVertices = v.size();
 	}
+	std::cout << "OBJ benchmark " << path << " (" << megabytes << " MB, best of " << runs << ")\n";
+	std::cout << "  native : " << nativeBest << " s, " << megabytes / nativeBest << " MB/s, " << nativeVertices << " vertices\n";
+	if (assimpVertices) std::cout << "  assimp : " << assimpBest << " s, " << megabytes / assimpBest << " MB/s, " << assimpVertices << " vertices ("
+		<< assimpBest / nativeBest << "x slower)\n";
+}
 
-	// Fill vertices normals
-	if (mesh->HasNormals()) {
-		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-			// std::cout<<"Number of Vertices : "<<mesh->mNumVertices<<"\n";
-			aiVector3D n = mesh->mNormals[i];
-			out_normals.push_back(glm::normalize(glm::vec3(n.x, n.y, n.z)));
-		}
-	}  
-	else {
-		//std::cout << "Model has no normals.\n";
-		//mesh->
-		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-			// std::cout<<"Number of Vertices : "<<mesh->mNumVertices<<"\n";
-			aiVector3D n = mesh->mNormals[i];
-			out_normals.push_back(glm::normalize(glm::vec3(n.x, n.y, n.z)));
+//Single thread faces/s of the SIMD per face curvature kernels (CurvatureSIMD.h) on a model's mesh. CPU only.
+void benchmarkCurvatureKernels(const std::string& path) {
+	Model model;
+	model.path = path;
+	model.useCache = false;
+	if (!model.loadCPU()) return;
+	VertexCorners corners;
+	buildVertexCorners(model.indices, model.vertices.size(), corners);
+	std::vector<float> pointAreas, cornerAreas;
+	computePointAreasCPU(model.vertices, model.indices, corners, pointAreas, cornerAreas);
+	CurvatureVertexSoA soa;
+	buildCurvatureVertexSoA(model.vertices, model.normals, model.indices, corners, pointAreas, soa);
+	benchmarkPerFaceKernels(path, soa, model.indices, cornerAreas);
+}
+
+//Results and best times of every CPU curvature stage in one scalar type, see benchmarkCurvaturePrecision().
+template<typename T>
+struct CurvatureStagesCPU {
+	static const int stageCount = 5;
+	std::vector<T> pointAreas, cornerAreas, curvatures, q1s, Dt1q1s;
+	std::vector<CurvatureVec4<T>> PDs, dcurv;
+	std::vector<CurvatureVec2<T>> t1s;
+	double seconds[stageCount] = { 1e30, 1e30, 1e30, 1e30, 1e30 };
+
+	void run(const Model& model, const VertexCorners& corners, const CurvatureVec3<T>& viewPosition, int runs) {
+		for (int run = 0; run < runs; run++) {
+			int stage = 0;
+			auto timed = [&](auto pass) {
+				auto start = std::chrono::high_resolution_clock::now();
+				pass();
+				std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+				seconds[stage] = std::min(seconds[stage], elapsed.count());
+				stage++;
+			};
+			timed([&] { computePointAreasCPU(model.vertices, model.indices, corners, pointAreas, cornerAreas); });
+			timed([&] { computeCurvaturesCPU(model.vertices, model.normals, model.indices, corners, pointAreas, cornerAreas, PDs, curvatures); });
+			timed([&] { computeCurvatureDerivativesCPU(model.vertices, model.indices, corners, pointAreas, cornerAreas, PDs, curvatures, dcurv); });
+			timed([&] { computeViewDependentCurvaturesCPU(model.vertices, model.normals, PDs, curvatures, viewPosition, q1s, t1s); });
+			timed([&] { computeDt1q1CPU(model.vertices, model.normals, model.indices, corners, PDs, q1s, t1s, viewPosition, Dt1q1s); });
 		}
 	}
-	// Fill face indices
-	//std::cout << "Number of faces :" << mesh->mNumFaces << "\n";
-	//std::cout << "Number of indices in faces :" << mesh->mFaces[0].mNumIndices << "\n";
-	for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-		for (unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; j++)
-			out_indices.push_back(mesh->mFaces[i].mIndices[j]);
+};
+
+//Largest difference between count float and double values finite in both, and how many aren't finite in each.
+inline void printPrecisionDifference(const float* single, const double* reference, size_t count) {
+	double difference = 0.0;
+	size_t nonFiniteSingle = 0, nonFiniteReference = 0;
+	for (size_t i = 0; i < count; i++) {
+		const bool finiteSingle = std::isfinite(single[i]), finiteReference = std::isfinite(reference[i]);
+		nonFiniteSingle += !finiteSingle;
+		nonFiniteReference += !finiteReference;
+		if (finiteSingle && finiteReference) difference = std::max(difference, std::abs(double(single[i]) - reference[i]));
 	}
+	std::cout << "max difference " << difference << ", not finite " << nonFiniteSingle << " float / " << nonFiniteReference << " double\n";
+}
 
-	std::cout << "Size of vertices : " << out_vertices.size() << "\n";
-	std::cout << "Size of normals : " << out_normals.size() << "\n";
-	std::cout << "Size of indices : " << out_indices.size() << "\n";
+//Time of every CPU curvature stage (CurvatureCPU.h, ViewDependentCPU.h) in float and in double on a model's mesh,
+//the slowdown of double and how far the float results are from the double ones. CPU only, on the whole thread pool.
+//Float runs the per face curvature step on the widest instruction set, double runs it scalar, as a validation run would.
+void benchmarkCurvaturePrecision(const std::string& path, int runs = 3) {
+	Model model;
+	model.path = path;
+	model.useCache = false;
+	if (!model.loadCPU() || model.indices.empty()) return;
+	VertexCorners corners;
+	buildVertexCorners(model.indices, model.vertices.size(), corners);
+	//viewer on the z axis, outside the bounding box
+	const glm::vec3 viewPosition = model.center + glm::vec3(0.0f, 0.0f, model.diagonalLength);
+	CurvatureStagesCPU<float> single;
+	CurvatureStagesCPU<double> reference;
+	single.run(model, corners, viewPosition, runs);
+	reference.run(model, corners, glm::dvec3(viewPosition), runs);
+
+	const size_t vertexCount = model.vertices.size();
+	const char* names[] = { "point areas", "curvatures", "curvature derivatives", "q1 / t1", "Dt1q1" };
+	const float* singleResults[] = { single.pointAreas.data(), single.curvatures.data(), &single.dcurv[0].x, single.q1s.data(), single.Dt1q1s.data() };
+	const double* referenceResults[] = { reference.pointAreas.data(), reference.curvatures.data(), &reference.dcurv[0].x, reference.q1s.data(), reference.Dt1q1s.data() };
+	const size_t resultCounts[] = { vertexCount, 2 * vertexCount, 4 * vertexCount, vertexCount, vertexCount };
+	std::cout << "Curvature precision benchmark " << path << " (" << vertexCount << " vertices, best of " << runs << ", "
+		<< globalThreadPool().size() << " threads, float per face step on " << simdLevelName(cpuSimdLevel()) << ")\n";
+	for (int stage = 0; stage < CurvatureStagesCPU<float>::stageCount; stage++) {
+		std::cout << "  " << names[stage] << " : float " << vertexCount / single.seconds[stage] / 1e6 << " M vertices/s, double "
+			<< vertexCount / reference.seconds[stage] / 1e6 << " M vertices/s (" << reference.seconds[stage] / single.seconds[stage] << "x slower), ";
+		printPrecisionDifference(singleResults[stage], referenceResults[stage], resultCounts[stage]);
+	}
+}
 
+//Checks moveVertices() / updateCurvatures() against computeCurvatures() : bumps the surface of one copy of a model
+//after its curvatures are computed, moves the same vertices of a second copy and computes it from scratch with every
+//normal regenerated, and prints the largest differences between the two. Both start from generated normals.
+//Principal directions are compared up to sign, derivatives by magnitude (their signs follow the directions').
+//Imports without the cache and needs the GL context current.
+void checkCurvatureUpdate(const std::string& path) {
+	Model edited, reference;
+	for (Model* model : { &edited, &reference }) {
+		model->path = path;
+		model->useCache = false;
+		model->streamIngest = false; //the reference is edited before its upload
+		model->regenerateNormals = true;
+		if (!model->loadCPU() || model->indices.empty()) return;
+	}
+	edited.uploadGL();
+	if (!edited.isSet) return;
+	const std::vector<uint32_t> moved = edited.bumpVertices(uint32_t(edited.vertices.size() / 2), 0.05f * edited.diagonalLength, 0.01f * edited.diagonalLength);
+	std::vector<glm::vec3> positions(moved.size());
+	for (size_t i = 0; i < moved.size(); i++) positions[i] = edited.vertices[moved[i]];
+	reference.moveVertices(moved, positions);
+	reference.generateNormals();
+	if (!reference.vertexStorage.empty()) reference.buildStorageArrays();
+	reference.uploadGL();
+	if (!reference.isSet) { edited.releaseGL(); return; }
+	edited.readBackComputed();
+	reference.readBackComputed();
+
+	const size_t nv = edited.vertices.size();
+	double normal = 0.0, curvature = 0.0, direction = 0.0, derivative = 0.0, area = 0.0;
+	for (size_t i = 0; i < nv; i++) normal = std::max(normal, double(glm::length(edited.normals[i] - reference.normals[i])));
+	for (size_t i = 0; i < 2 * nv; i++) {
+		curvature = std::max(curvature, double(std::abs(edited.PrincipalCurvatures[i] - reference.PrincipalCurvatures[i])));
+		direction = std::max(direction, 1.0 - std::abs(glm::dot(glm::vec3(edited.PDs[i]), glm::vec3(reference.PDs[i]))));
+	}
+	for (size_t i = 0; i < nv; i++) {
+		for (int k = 0; k < 4; k++) derivative = std::max(derivative, double(std::abs(std::abs(edited.dcurvs[i][k]) - std::abs(reference.dcurvs[i][k]))));
+		area = std::max(area, double(std::abs(edited.pointAreas[i] - reference.pointAreas[i])));
+	}
+	std::cout << "Curvature update check " << path << " (" << moved.size() << " of " << nv << " vertices moved)\n";
+	std::cout << "  max difference : normals " << normal << ", point areas " << area << ", curvatures " << curvature << ", directions (1 - |cos|) " << direction
+		<< ", derivatives " << derivative << "\n";
+	edited.releaseGL();
+	reference.releaseGL();
+}
 
-	// The "scene" pointer will be deleted automatically by "importer"
-	return true;
+//GPU time of the per frame view dependent passes (q1 / t1 and Dt1q1) with vertices in first use order
+//and in Morton order. Imports without the cache and needs the GL context current.
+void benchmarkVertexOrder(const std::string& path, int frames = 200) {
+	double milliseconds[2] = { 0.0, 0.0 };
+	double distance[2] = { 0.0, 0.0 };
+	GLuint query;
+	glGenQueries(1, &query);
+	for (int curve = 0; curve < 2; curve++) {
+		Model model;
+		model.path = path;
+		model.useCache = false;
+		model.spaceFillingOrder = (curve == 1);
+		if (!model.loadCPU()) { glDeleteQueries(1, &query); return; }
+		model.uploadGL();
+		model.modelMatrix = glm::mat4(1.0f);
+		model.viewPosition = glm::vec3(0.0f, 0.0f, 1.0f);
+		FrameConstants constants = {};
+		constants.viewPosition = glm::vec4(model.viewPosition, 1.0f);
+		frameUniforms().begin(constants);
+		DrawConstants draw = {};
+		draw.model = model.modelMatrix;
+		draw.objectViewPosition = glm::vec4(model.objectViewPosition(), 1.0f);
+		frameUniforms().draw(draw);
+		distance[curve] = meanEdgeIndexDistance(model.indices);
+		model.rebindSSBOs();
+		glBindVertexArray(model.VAO);
+		//warm up, then time every frame's pair of dispatches
+		model.dispatchPerVertex(model.viewDepCurvatureCompute);
+		model.dispatchPerVertex(model.Dt1q1Compute);
+		glFinish();
+		for (int frame = 0; frame < frames; frame++) {
+			glBeginQuery(GL_TIME_ELAPSED, query);
+			model.dispatchPerVertex(model.viewDepCurvatureCompute);
+			model.dispatchPerVertex(model.Dt1q1Compute);
+			glEndQuery(GL_TIME_ELAPSED);
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+			milliseconds[curve] += nanoseconds / 1e6;
+		}
+		milliseconds[curve] /= frames;
+		frameUniforms().end();
+		glBindVertexArray(0);
+		model.releaseGL();
+	}
+	glDeleteQueries(1, &query);
+	std::cout << "Vertex order benchmark " << path << " (" << frames << " frames)\n";
+	std::cout << "  first use : " << milliseconds[0] << " ms per frame, mean edge index distance " << distance[0] << "\n";
+	std::cout << "  Morton    : " << milliseconds[1] << " ms per frame, mean edge index distance " << distance[1]
+		<< " (" << milliseconds[0] / milliseconds[1] << "x)\n";
 }
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef MODEL_RESIDENCY_H
+#define MODEL_RESIDENCY_H
+//Keeps only recently used models resident on the GPU.
+//Models are loaded the first time they're asked for (or prefetched), and when the VRAM budget is exceeded
+//the least recently used ones give up their GL buffers but keep their host arrays, so coming back is just an upload.
+//Past the host budget, non-resident models drop their host arrays too and reload from their cache file.
+#include <vector>
+#include <string>
+#include <future>
+#include <chrono>
+#include <iostream>
+
+#include "Model.h"
+#include "ThreadPool.h"
+
+class ModelResidency {
+public:
+	size_t gpuBudgetBytes;
+	size_t hostBudgetBytes;
+
+	ModelResidency(const std::vector<std::string>& paths, size_t gpuBudgetBytes, size_t hostBudgetBytes)
+		: gpuBudgetBytes(gpuBudgetBytes), hostBudgetBytes(hostBudgetBytes), entries(paths.size()) {
+		for (size_t i = 0; i < paths.size(); i++) {
+			entries[i].path = paths[i];
+			entries[i].model.path = paths[i];
+			entries[i].name = entries[i].model.name();
+		}
+	}
+	//Pool tasks write into the entries' models, and the pool outlives this, so loads in flight finish first.
+	~ModelResidency() {
+		for (Entry& e : entries) if (e.pending.valid()) e.pending.wait();
+	}
+	ModelResidency(const ModelResidency&) = delete;
+	ModelResidency& operator=(const ModelResidency&) = delete;
+
+	size_t count() const { return entries.size(); }
+	const std::string& name(size_t index) const { return entries[index].name; }
+	bool isResident(size_t index) const { return entries[index].model.isSet; }
+	bool isLoading(size_t index) const { return entries[index].pending.valid(); }
+	bool failed(size_t index) const { return entries[index].failed; }
+	size_t pendingCount() const {
+		size_t n = 0;
+		for (const Entry& e : entries) n += e.pending.valid() ? 1 : 0;
+		return n;
+	}
+
+	//Starts the CPU stage of every model in the background (the old "load everything at startup" behaviour).
+	void prefetchAll() {
+		for (size_t i = 0; i < entries.size(); i++) this->startCPULoad(i);
+	}
+
+	//Call once per frame. Collects finished CPU stages; prefetched models are uploaded
+	//(at most one per frame) as long as they fit in the VRAM budget without evicting anything.
+	void update() {
+		bool uploaded = false;
+		for (size_t i = 0; i < entries.size(); i++) {
+			Entry& e = entries[i];
+			if (!this->collect(i)) continue;
+			//streaming ingest parses during the upload, its size isn't known until then : those wait for acquire()
+			if (!uploaded && e.prefetched && e.model.loaded && !e.model.isSet && !e.model.ingestPending
+				&& this->residentBytes() + e.model.gpuBytes() <= gpuBudgetBytes) {
+				e.model.uploadGL();
+				e.lastUsed = ++useCounter;
+				e.prefetched = false;
+				uploaded = true;
+			}
+		}
+	}
+
+	//Returns the model ready to render, or nullptr while it is still loading.
+	//Marks it as most recently used and evicts others if it doesn't fit the budget.
+	Model* acquire(size_t index) {
+		Entry& e = entries[index];
+		e.lastUsed = ++useCounter;
+		if (e.model.isSet) return &e.model;
+		if (e.failed) return nullptr;
+		if (!e.model.loaded) {
+			this->startCPULoad(index);
+			if (!this->collect(index) || !e.model.loaded) return nullptr;
+		}
+		this->evictFor(e.model.gpuBytes(), index);
+		auto start = std::chrono::high_resolution_clock::now();
+		e.model.uploadGL();
+		e.prefetched = false;
+		if (!e.model.isSet) { e.failed = true; return nullptr; }
+		//gpuBytes() was 0 before a streaming ingest
+		this->evictFor(0, index);
+		std::chrono::duration<double> elapsed_seconds = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "Made " << e.name << " resident. Took " << elapsed_seconds.count() << " seconds.\n";
+		this->trimHost(index);
+		return &e.model;
+	}
+
+	size_t residentBytes() const {
+		size_t total = 0;
+		for (const Entry& e : entries) if (e.model.isSet) total += e.model.gpuBytes();
+		return total;
+	}
+	size_t hostBytes() const {
+		size_t total = 0;
+		for (const Entry& e : entries) if (!e.pending.valid()) total += e.model.hostBytes();
+		return total;
+	}
+
+private:
+	struct Entry {
+		std::string path;
+		std::string name;
+		Model model;
+		std::future<void> pending; //CPU stage in flight
+		uint64_t lastUsed = 0;
+		bool prefetched = false;
+		bool failed = false;
+	};
+
+	void startCPULoad(size_t index) {
+		Entry& e = entries[index];
+		if (e.pending.valid() || e.model.loaded || e.failed) return;
+		e.prefetched = (e.lastUsed == 0);
+		Model* model = &e.model;
+		e.pending = globalThreadPool().submit([model] { model->loadCPU(); });
+	}
+	//True if the entry has no CPU stage in flight (anymore).
+	bool collect(size_t index) {
+		Entry& e = entries[index];
+		if (!e.pending.valid()) return true;
+		if (e.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+		e.pending.get();
+		if (!e.model.loaded) e.failed = true;
+		return true;
+	}
+	//Releases least recently used resident models until incomingBytes fits. Never evicts keepIndex.
+	void evictFor(size_t incomingBytes, size_t keepIndex) {
+		while (this->residentBytes() + incomingBytes > gpuBudgetBytes) {
+			Entry* victim = nullptr;
+			for (size_t i = 0; i < entries.size(); i++) {
+				Entry& e = entries[i];
+				if (i == keepIndex || !e.model.isSet) continue;
+				if (!victim || e.lastUsed < victim->lastUsed) victim = &e;
+			}
+			if (!victim) break; //a single model larger than the budget is still allowed
+			std::cout << "Evicting " << victim->name << " from GPU.\n";
+			victim->model.releaseGL();
+		}
+	}
+	//Drops host arrays of least recently used non-resident models while over the host budget.
+	//Edited models are skipped, their host arrays are the only copy of the edits.
+	void trimHost(size_t keepIndex) {
+		while (this->hostBytes() > hostBudgetBytes) {
+			Entry* victim = nullptr;
+			for (size_t i = 0; i < entries.size(); i++) {
+				Entry& e = entries[i];
+				if (i == keepIndex || e.model.isSet || e.model.edited || e.pending.valid() || !e.model.loaded) continue;
+				if (!victim || e.lastUsed < victim->lastUsed) victim = &e;
+			}
+			if (!victim) break;
+			victim->model.releaseHost();
+		}
+	}
+
+	std::vector<Entry> entries;
+	uint64_t useCounter = 0;
+};
+
+#endif
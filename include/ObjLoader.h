@@ -0,0 +1,247 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+//Native Wavefront OBJ reader, used instead of Assimp for .obj files.
+//The mapped file is split into newline aligned chunks. A quick parallel scan counts every chunk's elements, a prefix
+//sum over the counts gives every chunk its slice of the final arrays, then the chunks are parsed in parallel in place.
+//Only v, vn and f are read (polygons are fan triangulated), vt / groups / materials are skipped.
+//Vertices are indexed by position, so corners sharing a position share a vertex like after JoinIdenticalVertices.
+#include <vector>
+#include <string>
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include "MeshProcessing.h"
+
+//Stored in the cache header's import flags for meshes read by this loader.
+//Assimp's flags never set the high bit together with only bit 0, so the keys can't collide.
+const unsigned int objLoaderCacheKey = 0x80000001u;
+//Chunks are at least this large so tiny files aren't split for nothing.
+const size_t objMinChunkBytes = size_t(1) << 20;
+
+//Locale independent number parsing. p is advanced past the number, false if there is none.
+inline bool objParseInt(const char*& p, const char* end, int64_t& out) {
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) { negative = (*p == '-'); p++; }
+	if (p >= end || *p < '0' || *p > '9') return false;
+	int64_t value = 0;
+	while (p < end && *p >= '0' && *p <= '9') { value = value * 10 + (*p - '0'); p++; }
+	out = negative ? -value : value;
+	return true;
+}
+inline bool objParseFloat(const char*& p, const char* end, float& out) {
+	static const double powersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) { negative = (*p == '-'); p++; }
+	uint64_t mantissa = 0;
+	int exponent = 0, digits = 0;
+	bool any = false;
+	//digits past the 19th don't fit the mantissa and can't change a float anyway
+	for (; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+		if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; }
+		else exponent++;
+	}
+	if (p < end && *p == '.') {
+		p++;
+		for (; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+			if (digits < 19) { mantissa = mantissa * 10 + (*p - '0'); if (mantissa) digits++; exponent--; }
+		}
+	}
+	if (!any) return false;
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		const char* q = p + 1;
+		int64_t e;
+		if (objParseInt(q, end, e)) { exponent += int(std::max<int64_t>(-400, std::min<int64_t>(400, e))); p = q; }
+	}
+	double value = double(mantissa);
+	while (exponent > 22) { value *= 1e22; exponent -= 22; }
+	while (exponent < -22) { value /= 1e22; exponent += 22; }
+	value = (exponent >= 0) ? value * powersOfTen[exponent] : value / powersOfTen[-exponent];
+	out = float(negative ? -value : value);
+	return true;
+}
+
+//Counts of one chunk from a quick scan of its lines, so every chunk knows its slice of the final arrays
+//before anything is parsed and can write (and stream, see MeshStreamSink) its results in place.
+struct ObjChunkCounts {
+	size_t positions = 0;
+	size_t normals = 0;
+	size_t corners = 0; //3 per triangle after fan triangulation
+};
+inline bool objIsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+inline void objCountChunk(const char* p, const char* end, ObjChunkCounts& counts) {
+	while (p < end) {
+		while (p < end && (*p == ' ' || *p == '\t')) p++;
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if (!lineEnd) lineEnd = end;
+		if (lineEnd - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) counts.positions++;
+		else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) counts.normals++;
+		else if (lineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			//one corner per whitespace separated token, same as objParseChunk() reads them
+			size_t tokens = 0;
+			for (const char* q = p + 2; q < lineEnd;) {
+				while (q < lineEnd && objIsSpace(*q)) q++;
+				if (q >= lineEnd) break;
+				tokens++;
+				while (q < lineEnd && !objIsSpace(*q)) q++;
+			}
+			if (tokens >= 3) counts.corners += 3 * (tokens - 2);
+		}
+		p = lineEnd + 1;
+	}
+}
+
+//Where a chunk writes its results : its slices of the merged arrays, from the count pass.
+//Face indices are resolved (1 based, or relative to the elements so far) and range checked while parsing.
+struct ObjChunkTarget {
+	glm::vec3* positions;
+	glm::vec3* normals;         //the file's vn
+	unsigned int* corners;      //position index per corner
+	int64_t* cornerNormals;     //vn index per corner, -1 if none. Null if the file has no vn
+	size_t positionBase, normalBase;
+	size_t numVertices, numNormals;
+	ObjChunkCounts counts;
+};
+
+//False if the chunk has anything it doesn't understand or doesn't match the count pass.
+inline bool objParseChunk(const char* p, const char* end, const ObjChunkTarget& target) {
+	std::vector<int64_t> polygonPositions, polygonNormals;
+	size_t positions = 0, normals = 0, corners = 0;
+	while (p < end) {
+		while (p < end && (*p == ' ' || *p == '\t')) p++;
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		if (!lineEnd) lineEnd = end;
+		if (lineEnd - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+			glm::vec3 v;
+			const char* q = p + 2;
+			for (int k = 0; k < 3; k++) {
+				while (q < lineEnd && (*q == ' ' || *q == '\t')) q++;
+				if (!objParseFloat(q, lineEnd, v[k])) return false;
+			}
+			if (positions == target.counts.positions) return false;
+			target.positions[positions++] = v;
+		}
+		else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+			glm::vec3 n;
+			const char* q = p + 3;
+			for (int k = 0; k < 3; k++) {
+				while (q < lineEnd && (*q == ' ' || *q == '\t')) q++;
+				if (!objParseFloat(q, lineEnd, n[k])) return false;
+			}
+			if (normals == target.counts.normals) return false;
+			target.normals[normals++] = n;
+		}
+		else if (lineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			polygonPositions.clear(); polygonNormals.clear();
+			const char* q = p + 2;
+			while (true) {
+				while (q < lineEnd && objIsSpace(*q)) q++;
+				if (q >= lineEnd) break;
+				//v, v/vt, v//vn or v/vt/vn
+				int64_t v, vn = 0, unused;
+				if (!objParseInt(q, lineEnd, v) || v == 0) return false;
+				if (q < lineEnd && *q == '/') {
+					q++;
+					if (q < lineEnd && *q != '/') objParseInt(q, lineEnd, unused);
+					if (q < lineEnd && *q == '/') { q++; objParseInt(q, lineEnd, vn); }
+				}
+				if (q < lineEnd && !objIsSpace(*q)) return false;
+				const int64_t position = v > 0 ? v - 1 : int64_t(target.positionBase + positions) + v;
+				const int64_t normal = vn > 0 ? vn - 1 : (vn < 0 ? int64_t(target.normalBase + normals) + vn : -1);
+				if (position < 0 || position >= int64_t(target.numVertices) || normal < -1 || normal >= int64_t(target.numNormals)) return false;
+				polygonPositions.push_back(position);
+				polygonNormals.push_back(normal);
+			}
+			//fan triangulation, same as aiProcess_Triangulate for convex polygons
+			for (size_t k = 2; k < polygonPositions.size(); k++) {
+				const size_t corner[3] = { 0, k - 1, k };
+				if (corners + 3 > target.counts.corners) return false;
+				for (size_t c : corner) {
+					target.corners[corners] = static_cast<unsigned int>(polygonPositions[c]);
+					if (target.cornerNormals) target.cornerNormals[corners] = polygonNormals[c];
+					corners++;
+				}
+			}
+		}
+		p = lineEnd + 1;
+	}
+	return positions == target.counts.positions && normals == target.counts.normals && corners == target.counts.corners;
+}
+
+//Reads an OBJ into per vertex positions / normals and a triangle list.
+//Normals come from the file's vn (averaged where a position is referenced with several),
+//vertices without any are given area weighted smooth normals (generateVertexNormals()).
+//With a sink, every chunk's positions and triangles are handed to it as soon as the chunk is parsed,
+//normals once they're complete.
+//Returns false on anything it doesn't understand so the caller can fall back to Assimp.
+inline bool loadObj(const std::string& path, std::vector<glm::vec3>& out_vertices, std::vector<glm::vec3>& out_normals, std::vector<unsigned int>& out_indices,
+	const MeshStreamSink* sink = nullptr) {
+	MappedFile file(path);
+	if (!file.isOpen()) return false;
+	const char* data = reinterpret_cast<const char*>(file.data());
+	const size_t size = file.size();
+	ThreadPool& pool = globalThreadPool();
+
+	//newline aligned chunk boundaries
+	size_t chunkCount = std::max<size_t>(1, std::min(size / objMinChunkBytes, pool.size() * 4));
+	std::vector<size_t> bounds(1, 0);
+	for (size_t i = 1; i < chunkCount; i++) {
+		size_t at = std::max(bounds.back(), size * i / chunkCount);
+		const char* newline = static_cast<const char*>(std::memchr(data + at, '\n', size - at));
+		if (!newline) break;
+		bounds.push_back(size_t(newline - data) + 1);
+	}
+	bounds.push_back(size);
+	chunkCount = bounds.size() - 1;
+
+	std::vector<ObjChunkCounts> counts(chunkCount);
+	pool.parallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) objCountChunk(data + bounds[i], data + bounds[i + 1], counts[i]);
+	});
+	//exclusive prefix sums : where each chunk's elements go in the merged arrays
+	std::vector<size_t> positionBase(chunkCount + 1, 0), normalBase(chunkCount + 1, 0), cornerBase(chunkCount + 1, 0);
+	for (size_t i = 0; i < chunkCount; i++) {
+		positionBase[i + 1] = positionBase[i] + counts[i].positions;
+		normalBase[i + 1] = normalBase[i] + counts[i].normals;
+		cornerBase[i + 1] = cornerBase[i] + counts[i].corners;
+	}
+	const size_t numVertices = positionBase[chunkCount];
+	const size_t numFileNormals = normalBase[chunkCount];
+	const size_t numCorners = cornerBase[chunkCount];
+	if (numVertices < 3 || numCorners == 0 || numVertices > size_t(UINT32_MAX)) return false;
+
+	out_vertices.resize(numVertices);
+	out_indices.resize(numCorners);
+	std::vector<glm::vec3> fileNormals(numFileNormals);
+	std::vector<int64_t> cornerNormals(numFileNormals ? numCorners : 0);
+	if (sink && sink->sizes) sink->sizes(numVertices, numCorners);
+	std::atomic<bool> failed{ false };
+	pool.parallelFor(0, chunkCount, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end && !failed; i++) {
+			const ObjChunkTarget target = { out_vertices.data() + positionBase[i], fileNormals.data() + normalBase[i], out_indices.data() + cornerBase[i],
+				numFileNormals ? cornerNormals.data() + cornerBase[i] : nullptr, positionBase[i], normalBase[i], numVertices, numFileNormals, counts[i] };
+			if (!objParseChunk(data + bounds[i], data + bounds[i + 1], target)) { failed = true; return; }
+			if (sink && sink->positions) sink->positions(target.positions, positionBase[i], counts[i].positions);
+			if (sink && sink->indices) sink->indices(target.corners, cornerBase[i], counts[i].corners);
+		}
+	});
+	if (failed) return false;
+
+	//per vertex normals
+	out_normals.assign(numVertices, glm::vec3(0.0f));
+	for (size_t c = 0; c < cornerNormals.size(); c++) {
+		if (cornerNormals[c] >= 0) out_normals[out_indices[c]] += fileNormals[cornerNormals[c]];
+	}
+	completeVertexNormals(out_vertices, out_indices, out_normals);
+	if (sink && sink->normals) sink->normals(out_normals.data(), 0, numVertices);
+	return true;
+}
+
+#endif
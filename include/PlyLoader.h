@@ -0,0 +1,443 @@
+#ifndef PLY_LOADER_H
+#define PLY_LOADER_H
+//Native binary PLY reader, used instead of Assimp for .ply files.
+//The file is mapped and the header parsed into element / property layouts. Element blocks are then
+//read straight from the mapping : native byte order layouts that need no conversion (x,y,z floats next to
+//each other at any record stride, triangle faces with 32 bit indices) are exposed as spans over the mapping
+//(vec3Span(), triangleSpan()), anything else (doubles, big endian, polygons) goes through a strided conversion.
+//Faces come from a "face" list (fan triangulated) or "tristrips" (-1 separated, as written by trimesh2).
+//ASCII PLY is left to Assimp.
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include "MeshProcessing.h"
+
+//Stored in the cache header's import flags for meshes read by this loader (see objLoaderCacheKey).
+const unsigned int plyLoaderCacheKey = 0x80000002u;
+
+enum PlyType { PLY_CHAR, PLY_UCHAR, PLY_SHORT, PLY_USHORT, PLY_INT, PLY_UINT, PLY_FLOAT, PLY_DOUBLE, PLY_INVALID };
+
+inline PlyType plyTypeFromName(const std::string& name) {
+	if (name == "char" || name == "int8") return PLY_CHAR;
+	if (name == "uchar" || name == "uint8") return PLY_UCHAR;
+	if (name == "short" || name == "int16") return PLY_SHORT;
+	if (name == "ushort" || name == "uint16") return PLY_USHORT;
+	if (name == "int" || name == "int32") return PLY_INT;
+	if (name == "uint" || name == "uint32") return PLY_UINT;
+	if (name == "float" || name == "float32") return PLY_FLOAT;
+	if (name == "double" || name == "float64") return PLY_DOUBLE;
+	return PLY_INVALID;
+}
+inline size_t plyTypeSize(PlyType type) {
+	static const size_t sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+	return sizes[type];
+}
+//Reads one value of the given type, byte swapping if the file's endianness differs from ours.
+template<typename T>
+inline T plyRead(const unsigned char* p, PlyType type, bool swap) {
+	unsigned char bytes[8] = {};
+	const size_t size = plyTypeSize(type);
+	if (swap) { for (size_t i = 0; i < size; i++) bytes[i] = p[size - 1 - i]; }
+	else std::memcpy(bytes, p, size);
+	switch (type) {
+	case PLY_CHAR: { int8_t v; std::memcpy(&v, bytes, 1); return T(v); }
+	case PLY_UCHAR: { uint8_t v; std::memcpy(&v, bytes, 1); return T(v); }
+	case PLY_SHORT: { int16_t v; std::memcpy(&v, bytes, 2); return T(v); }
+	case PLY_USHORT: { uint16_t v; std::memcpy(&v, bytes, 2); return T(v); }
+	case PLY_INT: { int32_t v; std::memcpy(&v, bytes, 4); return T(v); }
+	case PLY_UINT: { uint32_t v; std::memcpy(&v, bytes, 4); return T(v); }
+	case PLY_FLOAT: { float v; std::memcpy(&v, bytes, 4); return T(v); }
+	case PLY_DOUBLE: { double v; std::memcpy(&v, bytes, 8); return T(v); }
+	default: return T(0);
+	}
+}
+
+//Read only view of count elements of T, stride bytes apart, inside the mapping of the PlyFile it came from.
+//Only valid while that PlyFile is open. Records aren't aligned in general, so elements are read with memcpy.
+template<typename T>
+struct PlySpan {
+	const unsigned char* base = nullptr;
+	size_t stride = 0;
+	size_t count = 0;
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	T operator[](size_t i) const {
+		T value;
+		std::memcpy(&value, base + i * stride, sizeof(T));
+		return value;
+	}
+	//Packed spans are just the elements back to back.
+	bool packed() const { return stride == sizeof(T); }
+	//Elements [first, first + n) into out, a single memcpy when packed.
+	void copyTo(T* out, size_t first, size_t n) const {
+		if (this->packed()) { std::memcpy(out, base + first * stride, n * sizeof(T)); return; }
+		for (size_t i = 0; i < n; i++) std::memcpy(out + i, base + (first + i) * stride, sizeof(T));
+	}
+};
+
+struct PlyProperty {
+	std::string name;
+	PlyType type = PLY_INVALID;       //item type for lists
+	PlyType countType = PLY_INVALID;  //only for lists
+	bool isList = false;
+	size_t offset = 0;                //byte offset inside a record, only meaningful for fixed size elements
+};
+struct PlyElement {
+	std::string name;
+	size_t count = 0;
+	std::vector<PlyProperty> properties;
+	size_t stride = 0;                //record size, 0 if the element has list properties
+	size_t dataOffset = SIZE_MAX;     //from the start of the file, SIZE_MAX until located
+	int property(const std::string& propertyName) const {
+		for (size_t i = 0; i < properties.size(); i++) if (properties[i].name == propertyName) return int(i);
+		return -1;
+	}
+};
+
+//Mapped binary PLY file with a parsed header.
+class PlyFile {
+public:
+	std::vector<PlyElement> elements;
+	bool bigEndian = false;
+
+	bool open(const std::string& path) {
+		if (!file.open(path)) return false;
+		const char* text = reinterpret_cast<const char*>(file.data());
+		const size_t headerSearch = std::min<size_t>(file.size(), 1 << 16);
+		const char* marker = nullptr;
+		for (const char* p = text; p + 10 <= text + headerSearch; p++) {
+			if (std::memcmp(p, "end_header", 10) == 0) { marker = p; break; }
+		}
+		if (file.size() < 4 || std::memcmp(text, "ply", 3) != 0 || !marker) { file.close(); return false; }
+		const char* bodyStart = static_cast<const char*>(std::memchr(marker, '\n', text + file.size() - marker));
+		if (!bodyStart) { file.close(); return false; }
+
+		std::istringstream header(std::string(text, marker));
+		std::string line;
+		bool binary = false;
+		while (std::getline(header, line)) {
+			std::istringstream words(line);
+			std::string keyword;
+			words >> keyword;
+			if (keyword == "format") {
+				std::string format;
+				words >> format;
+				binary = (format == "binary_little_endian" || format == "binary_big_endian");
+				bigEndian = (format == "binary_big_endian");
+			}
+			else if (keyword == "element") {
+				PlyElement element;
+				words >> element.name >> element.count;
+				elements.push_back(element);
+			}
+			else if (keyword == "property" && !elements.empty()) {
+				PlyProperty property;
+				std::string typeName;
+				words >> typeName;
+				if (typeName == "list") {
+					std::string countTypeName, itemTypeName;
+					words >> countTypeName >> itemTypeName;
+					property.isList = true;
+					property.countType = plyTypeFromName(countTypeName);
+					property.type = plyTypeFromName(itemTypeName);
+					if (property.countType == PLY_INVALID || property.countType == PLY_FLOAT || property.countType == PLY_DOUBLE) { file.close(); return false; }
+				}
+				else property.type = plyTypeFromName(typeName);
+				if (property.type == PLY_INVALID) { file.close(); return false; }
+				words >> property.name;
+				elements.back().properties.push_back(property);
+			}
+		}
+		if (!binary) { file.close(); return false; }
+
+		for (PlyElement& element : elements) {
+			size_t offset = 0;
+			for (PlyProperty& property : element.properties) {
+				if (property.isList) { offset = 0; break; }
+				property.offset = offset;
+				offset += plyTypeSize(property.type);
+			}
+			element.stride = offset;
+		}
+		swapBytes = (bigEndian != hostIsBigEndian());
+		if (!elements.empty()) elements[0].dataOffset = size_t(bodyStart + 1 - text);
+		return true;
+	}
+	const PlyElement* element(const std::string& name) const {
+		for (const PlyElement& e : elements) if (e.name == name) return &e;
+		return nullptr;
+	}
+	//Start of an element's data block. Fixed size elements before it are skipped arithmetically,
+	//ones with lists have to be walked. SIZE_MAX if the file is truncated.
+	size_t locate(const PlyElement* target) {
+		for (size_t i = 0; i < elements.size(); i++) {
+			PlyElement& e = elements[i];
+			if (&e == target) return e.dataOffset;
+			if (e.dataOffset == SIZE_MAX) return SIZE_MAX;
+			if (i + 1 < elements.size() && elements[i + 1].dataOffset == SIZE_MAX) {
+				size_t end = e.dataOffset;
+				for (size_t r = 0; r < e.count && end != SIZE_MAX; r++) end = this->skipRecord(e, end);
+				if (end > file.size()) end = SIZE_MAX;
+				elements[i + 1].dataOffset = end;
+			}
+		}
+		return SIZE_MAX;
+	}
+	//Byte offset just past the record starting at offset, SIZE_MAX if it runs off the end.
+	size_t skipRecord(const PlyElement& e, size_t offset) const {
+		if (e.stride) return (offset + e.stride <= file.size()) ? offset + e.stride : SIZE_MAX;
+		for (const PlyProperty& property : e.properties) {
+			if (!property.isList) { offset += plyTypeSize(property.type); continue; }
+			if (offset + plyTypeSize(property.countType) > file.size()) return SIZE_MAX;
+			int64_t count = plyRead<int64_t>(file.data() + offset, property.countType, swapBytes);
+			if (count < 0) return SIZE_MAX;
+			offset += plyTypeSize(property.countType) + size_t(count) * plyTypeSize(property.type);
+		}
+		return (offset <= file.size()) ? offset : SIZE_MAX;
+	}
+
+	//Three float properties of the vertex element (x/y/z, nx/ny/nz) as a span over the mapping, if they're
+	//native order floats next to each other. The record can hold anything else around them (x y z nx ny nz, colors...).
+	bool vec3Span(const std::string& nx, const std::string& ny, const std::string& nz, PlySpan<glm::vec3>& out) {
+		const PlyElement* vertex = this->element("vertex");
+		if (swapBytes || !vertex || vertex->stride == 0) return false;
+		const int px = vertex->property(nx), py = vertex->property(ny), pz = vertex->property(nz);
+		if (px < 0 || py < 0 || pz < 0) return false;
+		const PlyProperty& x = vertex->properties[px];
+		const PlyProperty& y = vertex->properties[py];
+		const PlyProperty& z = vertex->properties[pz];
+		if (x.type != PLY_FLOAT || y.type != PLY_FLOAT || z.type != PLY_FLOAT || y.offset != x.offset + 4 || z.offset != x.offset + 8) return false;
+		const size_t offset = this->locate(vertex);
+		if (offset == SIZE_MAX || offset + vertex->count * vertex->stride > file.size()) return false;
+		out.base = file.data() + offset + x.offset;
+		out.stride = vertex->stride;
+		out.count = vertex->count;
+		return true;
+	}
+	//The "face" element as a span of triangles over the mapping, if every record is just a list of 3 native order
+	//32 bit indices. Counts are checked here, indices are only range checked by readTriangles().
+	bool triangleSpan(PlySpan<glm::uvec3>& out) {
+		const PlyElement* face = this->element("face");
+		if (swapBytes || !face || face->properties.size() != 1 || !face->properties[0].isList) return false;
+		const PlyProperty& list = face->properties[0];
+		if (list.type != PLY_INT && list.type != PLY_UINT) return false;
+		const size_t countSize = plyTypeSize(list.countType);
+		const size_t record = countSize + 3 * sizeof(uint32_t);
+		const size_t offset = this->locate(face);
+		if (offset == SIZE_MAX || offset + face->count * record != file.size()) return false;
+		const unsigned char* base = file.data() + offset;
+		const PlyType countType = list.countType;
+		std::atomic<bool> allTriangles{ true };
+		globalThreadPool().parallelFor(0, face->count, 1 << 16, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+				if (plyRead<int64_t>(base + i * record, countType, false) != 3) { allTriangles = false; return; }
+		});
+		if (!allTriangles) return false;
+		out.base = base + countSize;
+		out.stride = record;
+		out.count = face->count;
+		return true;
+	}
+
+	//Three float properties of the vertex element (x/y/z, nx/ny/nz) into out.
+	//Copied from vec3Span() when there is one (a single memcpy if packed), anything else is converted record by record.
+	bool readVec3(const std::string& nx, const std::string& ny, const std::string& nz, std::vector<glm::vec3>& out) {
+		PlySpan<glm::vec3> span;
+		if (this->vec3Span(nx, ny, nz, span)) {
+			out.resize(span.size());
+			globalThreadPool().parallelFor(0, span.size(), 1 << 16, [&](size_t begin, size_t end) {
+				span.copyTo(out.data() + begin, begin, end - begin);
+			});
+			return true;
+		}
+		const PlyElement* vertex = this->element("vertex");
+		if (!vertex || vertex->stride == 0) return false;
+		const int px = vertex->property(nx), py = vertex->property(ny), pz = vertex->property(nz);
+		if (px < 0 || py < 0 || pz < 0) return false;
+		const size_t offset = this->locate(vertex);
+		if (offset == SIZE_MAX || offset + vertex->count * vertex->stride > file.size()) return false;
+		const unsigned char* base = file.data() + offset;
+		const PlyProperty& x = vertex->properties[px];
+		const PlyProperty& y = vertex->properties[py];
+		const PlyProperty& z = vertex->properties[pz];
+		out.resize(vertex->count);
+		const size_t stride = vertex->stride;
+		const bool swap = swapBytes;
+		globalThreadPool().parallelFor(0, vertex->count, 1 << 16, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				const unsigned char* record = base + i * stride;
+				out[i] = glm::vec3(plyRead<float>(record + x.offset, x.type, swap), plyRead<float>(record + y.offset, y.type, swap), plyRead<float>(record + z.offset, z.type, swap));
+			}
+		});
+		return true;
+	}
+
+	//Triangle list from a "face" element (fan triangulated) or "tristrips". Indices are range checked.
+	//Copied from triangleSpan() when there is one.
+	bool readTriangles(std::vector<unsigned int>& out, size_t numVertices) {
+		out.clear();
+		PlySpan<glm::uvec3> triangles;
+		if (this->triangleSpan(triangles)) {
+			out.resize(triangles.size() * 3);
+			globalThreadPool().parallelFor(0, triangles.size(), 1 << 16, [&](size_t begin, size_t end) {
+				triangles.copyTo(reinterpret_cast<glm::uvec3*>(out.data()) + begin, begin, end - begin);
+			});
+			return this->indicesInRange(out, numVertices);
+		}
+		if (const PlyElement* face = this->element("face")) {
+			int listIndex = face->property("vertex_indices");
+			if (listIndex < 0) listIndex = face->property("vertex_index");
+			if (listIndex < 0 || !face->properties[listIndex].isList) return false;
+			const size_t offset = this->locate(face);
+			if (offset == SIZE_MAX) return false;
+			if (this->readTriangleFaces(*face, size_t(listIndex), offset, out)) return this->indicesInRange(out, numVertices);
+			return false;
+		}
+		if (const PlyElement* strips = this->element("tristrips")) {
+			if (strips->properties.empty() || !strips->properties[0].isList) return false;
+			const size_t offset = this->locate(strips);
+			if (offset == SIZE_MAX) return false;
+			size_t at = offset;
+			const PlyProperty& list = strips->properties[0];
+			for (size_t r = 0; r < strips->count; r++) {
+				size_t next = this->skipRecord(*strips, at);
+				if (next == SIZE_MAX) return false;
+				int64_t count = plyRead<int64_t>(file.data() + at, list.countType, swapBytes);
+				this->unpackStrip(file.data() + at + plyTypeSize(list.countType), size_t(count), list.type, out);
+				at = next;
+			}
+			return this->indicesInRange(out, numVertices);
+		}
+		return false;
+	}
+
+private:
+	static bool hostIsBigEndian() {
+		const uint16_t probe = 1;
+		unsigned char first;
+		std::memcpy(&first, &probe, 1);
+		return first == 0;
+	}
+	bool indicesInRange(const std::vector<unsigned int>& indices, size_t numVertices) const {
+		for (unsigned int index : indices) if (index >= numVertices) return false;
+		return !indices.empty();
+	}
+	//Pure triangle meshes with a single list property have fixed size records, so they're converted in parallel.
+	//Mixed polygon sizes are walked and fan triangulated.
+	bool readTriangleFaces(const PlyElement& face, size_t listIndex, size_t offset, std::vector<unsigned int>& out) const {
+		const PlyProperty& list = face.properties[listIndex];
+		const size_t countSize = plyTypeSize(list.countType), itemSize = plyTypeSize(list.type);
+		const size_t triangleRecord = countSize + 3 * itemSize;
+		const bool onlyList = (face.properties.size() == 1);
+		if (onlyList && offset + face.count * triangleRecord == file.size()) {
+			const unsigned char* base = file.data() + offset;
+			const bool swap = swapBytes;
+			std::atomic<bool> allTriangles{ true };
+			out.resize(face.count * 3);
+			globalThreadPool().parallelFor(0, face.count, 1 << 16, [&](size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					const unsigned char* record = base + i * triangleRecord;
+					if (plyRead<int64_t>(record, list.countType, swap) != 3) { allTriangles = false; return; }
+					for (size_t k = 0; k < 3; k++) out[3 * i + k] = plyRead<unsigned int>(record + countSize + k * itemSize, list.type, swap);
+				}
+			});
+			if (allTriangles) return true;
+			out.clear();
+		}
+		size_t at = offset;
+		std::vector<unsigned int> polygon;
+		for (size_t r = 0; r < face.count; r++) {
+			size_t next = this->skipRecord(face, at);
+			if (next == SIZE_MAX) return false;
+			size_t field = at;
+			for (size_t p = 0; p < face.properties.size(); p++) {
+				const PlyProperty& property = face.properties[p];
+				if (!property.isList) { field += plyTypeSize(property.type); continue; }
+				int64_t count = plyRead<int64_t>(file.data() + field, property.countType, swapBytes);
+				field += plyTypeSize(property.countType);
+				if (p == listIndex) {
+					polygon.resize(size_t(count));
+					for (size_t k = 0; k < polygon.size(); k++) polygon[k] = plyRead<unsigned int>(file.data() + field + k * itemSize, property.type, swapBytes);
+					for (size_t k = 2; k < polygon.size(); k++) {
+						out.push_back(polygon[0]); out.push_back(polygon[k - 1]); out.push_back(polygon[k]);
+					}
+				}
+				field += size_t(count) * plyTypeSize(property.type);
+			}
+			at = next;
+		}
+		return true;
+	}
+	//-1 restarts the strip, every other triangle is flipped to keep the winding. Degenerate stitching triangles are dropped.
+	void unpackStrip(const unsigned char* items, size_t count, PlyType type, std::vector<unsigned int>& out) const {
+		const size_t itemSize = plyTypeSize(type);
+		size_t length = 0;
+		int64_t a = 0, b = 0;
+		for (size_t i = 0; i < count; i++) {
+			int64_t c = plyRead<int64_t>(items + i * itemSize, type, swapBytes);
+			if (c < 0) { length = 0; continue; }
+			if (length >= 2 && a != b && b != c && a != c) {
+				if (length & 1) { out.push_back(unsigned(a)); out.push_back(unsigned(c)); out.push_back(unsigned(b)); }
+				else { out.push_back(unsigned(a)); out.push_back(unsigned(b)); out.push_back(unsigned(c)); }
+			}
+			a = b; b = c;
+			length++;
+		}
+	}
+
+	MappedFile file;
+	bool swapBytes = false;
+};
+
+//Reads a binary PLY into per vertex positions / normals and a triangle list.
+//Files without normals get area weighted smooth normals (generateVertexNormals()).
+//With a sink and both blocks available as spans, the sizes are known from the header, so positions and triangles
+//are handed to it chunk by chunk as they're copied out of the mapping, normals once they're complete.
+//Other layouts are converted first and handed over whole.
+//Returns false for ASCII or anything it doesn't understand so the caller can fall back to Assimp.
+inline bool loadPly(const std::string& path, std::vector<glm::vec3>& out_vertices, std::vector<glm::vec3>& out_normals, std::vector<unsigned int>& out_indices,
+	const MeshStreamSink* sink = nullptr) {
+	PlyFile ply;
+	if (!ply.open(path)) return false;
+	PlySpan<glm::vec3> positions;
+	PlySpan<glm::uvec3> triangles;
+	if (sink && ply.vec3Span("x", "y", "z", positions) && positions.size() >= 3 && ply.triangleSpan(triangles) && !triangles.empty()) {
+		const size_t numVertices = positions.size();
+		out_vertices.resize(numVertices);
+		out_indices.resize(triangles.size() * 3);
+		if (sink->sizes) sink->sizes(numVertices, out_indices.size());
+		globalThreadPool().parallelFor(0, numVertices, 1 << 16, [&](size_t begin, size_t end) {
+			positions.copyTo(out_vertices.data() + begin, begin, end - begin);
+			if (sink->positions) sink->positions(out_vertices.data() + begin, begin, end - begin);
+		});
+		std::atomic<bool> outOfRange{ false };
+		globalThreadPool().parallelFor(0, triangles.size(), 1 << 16, [&](size_t begin, size_t end) {
+			unsigned int* out = out_indices.data() + 3 * begin;
+			triangles.copyTo(reinterpret_cast<glm::uvec3*>(out), begin, end - begin);
+			for (size_t i = 0; i < 3 * (end - begin); i++) if (out[i] >= numVertices) { outOfRange = true; return; }
+			if (sink->indices) sink->indices(out, 3 * begin, 3 * (end - begin));
+		});
+		if (outOfRange) return false;
+	}
+	else {
+		if (!ply.readVec3("x", "y", "z", out_vertices) || out_vertices.size() < 3) return false;
+		if (!ply.readTriangles(out_indices, out_vertices.size())) return false;
+		if (sink && sink->sizes) sink->sizes(out_vertices.size(), out_indices.size());
+		if (sink && sink->positions) sink->positions(out_vertices.data(), 0, out_vertices.size());
+		if (sink && sink->indices) sink->indices(out_indices.data(), 0, out_indices.size());
+	}
+	if (!ply.readVec3("nx", "ny", "nz", out_normals)) out_normals.assign(out_vertices.size(), glm::vec3(0.0f));
+	completeVertexNormals(out_vertices, out_indices, out_normals);
+	if (sink && sink->normals) sink->normals(out_normals.data(), 0, out_normals.size());
+	return true;
+}
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef STAGING_RING_H
+#define STAGING_RING_H
+//Persistently mapped staging buffer split into fixed size slots, for streaming mesh data into GPU buffers
+//while it is still being produced.
+//A producer thread fills free slots through the mapped pointer and submits them with a destination;
+//the GL thread (drain()) copies submitted slots into their destination buffers and fences them.
+//A slot becomes free again once its fence signals, so host memory in flight never exceeds the ring size.
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <glad/glad.h>
+
+class StagingRing {
+public:
+	const size_t slotBytes;
+	const size_t slotCount;
+
+	//Needs the GL context current. GL 4.4 for glBufferStorage.
+	StagingRing(size_t slotBytes = size_t(4) << 20, size_t slotCount = 8) : slotBytes(slotBytes), slotCount(slotCount), slots(slotCount) {
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glBufferStorage(GL_COPY_READ_BUFFER, slotBytes * slotCount, nullptr, flags);
+		mapped = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, slotBytes * slotCount, flags));
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+	StagingRing(const StagingRing&) = delete;
+	StagingRing& operator=(const StagingRing&) = delete;
+	bool isMapped() const { return mapped != nullptr; }
+
+	//Called on the GL thread before starting a producer.
+	void begin() {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = false;
+		submittedBytes = 0;
+	}
+
+	//Producer side (any thread).
+	//Blocks until a slot is free, returns its index.
+	size_t acquire() {
+		std::unique_lock<std::mutex> lock(mutex);
+		size_t slot = 0;
+		condition.wait(lock, [&] {
+			for (slot = 0; slot < slotCount; slot++) if (slots[slot].state == SLOT_FREE) return true;
+			return false;
+		});
+		slots[slot].state = SLOT_FILLING;
+		return slot;
+	}
+	unsigned char* data(size_t slot) { return mapped + slot * slotBytes; }
+	//Hands a filled slot to the GL thread, which copies bytes of it to destination at destinationOffset.
+	void submit(size_t slot, GLuint destination, size_t destinationOffset, size_t bytes) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			Slot& s = slots[slot];
+			s.state = SLOT_READY;
+			s.destination = destination;
+			s.destinationOffset = destinationOffset;
+			s.bytes = bytes;
+			ready.push_back(slot);
+			submittedBytes += bytes;
+		}
+		condition.notify_all();
+	}
+	//Producer is done, drain() returns once everything submitted has been copied.
+	void close() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+		}
+		condition.notify_all();
+	}
+	//Writes count elements of elementBytes each into destination, from element destinationFirst on, through the ring.
+	//fill(dst, first, n) writes elements [first, first + n) of the count to dst.
+	template<typename F>
+	void stream(GLuint destination, size_t count, size_t elementBytes, F fill, size_t destinationFirst = 0) {
+		const size_t perSlot = std::max<size_t>(1, slotBytes / elementBytes);
+		for (size_t first = 0; first < count; first += perSlot) {
+			const size_t n = std::min(perSlot, count - first);
+			const size_t slot = this->acquire();
+			fill(this->data(slot), first, n);
+			this->submit(slot, destination, (destinationFirst + first) * elementBytes, n * elementBytes);
+		}
+	}
+
+	//GL thread. Copies submitted slots into their destinations and recycles them as their fences signal,
+	//until the producer has closed and every slot is free again. Returns the number of bytes streamed.
+	size_t drain() {
+		std::deque<size_t> inFlight;
+		while (true) {
+			std::vector<size_t> toCopy;
+			bool finished;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				//nothing to copy and nothing to retire : sleep until the producer submits
+				if (inFlight.empty()) condition.wait(lock, [&] { return !ready.empty() || closed; });
+				toCopy.assign(ready.begin(), ready.end());
+				ready.clear();
+				finished = closed;
+				for (size_t slot : toCopy) slots[slot].state = SLOT_IN_FLIGHT;
+			}
+			for (size_t slot : toCopy) {
+				Slot& s = slots[slot];
+				glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+				glBindBuffer(GL_COPY_WRITE_BUFFER, s.destination);
+				glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, slot * slotBytes, s.destinationOffset, s.bytes);
+				s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+				inFlight.push_back(slot);
+			}
+			//Retire finished copies. Only block on the oldest one if there's nothing else to do.
+			bool retired = false;
+			while (!inFlight.empty()) {
+				Slot& s = slots[inFlight.front()];
+				const GLuint64 timeout = (toCopy.empty() && !retired) ? GLuint64(1000000) : 0; //1ms
+				GLenum status = glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+				if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+				glDeleteSync(s.fence);
+				s.fence = nullptr;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					s.state = SLOT_FREE;
+				}
+				condition.notify_all();
+				inFlight.pop_front();
+				retired = true;
+			}
+			if (finished && toCopy.empty() && inFlight.empty()) {
+				std::lock_guard<std::mutex> lock(mutex);
+				if (ready.empty()) break;
+			}
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		std::lock_guard<std::mutex> lock(mutex);
+		return submittedBytes;
+	}
+
+private:
+	enum SlotState { SLOT_FREE, SLOT_FILLING, SLOT_READY, SLOT_IN_FLIGHT };
+	struct Slot {
+		SlotState state = SLOT_FREE;
+		GLuint destination = 0;
+		size_t destinationOffset = 0;
+		size_t bytes = 0;
+		GLsync fence = nullptr;
+	};
+	GLuint buffer = 0;
+	unsigned char* mapped = nullptr;
+	std::vector<Slot> slots;
+	std::deque<size_t> ready;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool closed = false;
+	size_t submittedBytes = 0;
+};
+
+//Ring shared by every model's uploads. Created on first use, so the GL context must be current.
+//Never destroyed : by the time statics are torn down the context is already gone.
+inline StagingRing& stagingRing() {
+	static StagingRing* ring = new StagingRing();
+	return *ring;
+}
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+//Small fixed size thread pool for CPU side loading work.
+//submit() queues a task and returns a future, parallelFor() splits a range into chunks.
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+
+class ThreadPool {
+public:
+	ThreadPool(unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency())) {
+		for (unsigned int i = 0; i < threadCount; i++) {
+			workers.emplace_back([this] { this->workerLoop(); });
+		}
+	}
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			stopping = true;
+		}
+		queueCondition.notify_all();
+		for (std::thread& worker : workers) worker.join();
+	}
+
+	size_t size() const { return workers.size(); }
+
+	template<typename F>
+	auto submit(F task) -> std::future<decltype(task())> {
+		typedef decltype(task()) Result;
+		auto packaged = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+		std::future<Result> result = packaged->get_future();
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			tasks.emplace_back([packaged] { (*packaged)(); });
+		}
+		queueCondition.notify_one();
+		return result;
+	}
+
+	//Calls body(chunkBegin, chunkEnd) over [begin, end) in chunks of at most grainSize.
+	//The calling thread works on chunks too, so this is safe to call from inside a pool task.
+	template<typename F>
+	void parallelFor(size_t begin, size_t end, size_t grainSize, F body) {
+		if (end <= begin) return;
+		grainSize = std::max<size_t>(1, grainSize);
+		const size_t chunkCount = (end - begin + grainSize - 1) / grainSize;
+		if (chunkCount == 1 || workers.empty()) { body(begin, end); return; }
+
+		struct SharedState {
+			std::atomic<size_t> nextChunk{ 0 };
+			std::atomic<size_t> doneChunks{ 0 };
+			std::mutex doneMutex;
+			std::condition_variable doneCondition;
+		};
+		auto state = std::make_shared<SharedState>();
+		auto runChunks = [state, begin, end, grainSize, chunkCount, &body] {
+			size_t chunk;
+			while ((chunk = state->nextChunk.fetch_add(1)) < chunkCount) {
+				size_t chunkBegin = begin + chunk * grainSize;
+				body(chunkBegin, std::min(end, chunkBegin + grainSize));
+				if (state->doneChunks.fetch_add(1) + 1 == chunkCount) {
+					std::lock_guard<std::mutex> lock(state->doneMutex);
+					state->doneCondition.notify_all();
+				}
+			}
+		};
+		//Helpers that start after every chunk is taken return immediately,
+		//and body is only touched while a chunk is in flight, so capturing it by reference is fine.
+		size_t helpers = std::min(workers.size(), chunkCount - 1);
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			for (size_t i = 0; i < helpers; i++) tasks.emplace_back(runChunks);
+		}
+		queueCondition.notify_all();
+		runChunks();
+		std::unique_lock<std::mutex> lock(state->doneMutex);
+		state->doneCondition.wait(lock, [&] { return state->doneChunks.load() == chunkCount; });
+	}
+
+private:
+	void workerLoop() {
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				queueCondition.wait(lock, [this] { return stopping || !tasks.empty(); });
+				if (stopping && tasks.empty()) return;
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	bool stopping = false;
+};
+
+//Pool shared by model loading and the CPU side mesh processing.
+inline ThreadPool& globalThreadPool() {
+	static ThreadPool pool;
+	return pool;
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef VIEW_DEPENDENT_CPU_H
+#define VIEW_DEPENDENT_CPU_H
+//CPU version of the per frame view dependent passes, viewDepCurv.compute (q1, t1) and Dt1q1.compute, templated on the
+//scalar type like CurvatureCPU.h. For checking the compute shaders and comparing float against double.
+//Evaluated in object space : viewPosition is in the model's coordinates, same as the shaders with an identity model matrix.
+#include <vector>
+#include <cmath>
+#include <glm/glm.hpp>
+
+#include "ThreadPool.h"
+#include "MeshProcessing.h"
+#include "CurvatureCPU.h"
+
+template<typename T> using CurvatureVec2 = glm::vec<2, T, glm::defaultp>;
+
+//Max view dependent curvature q1 and its direction t1 (in the max / min PDs) per vertex.
+template<typename T>
+inline void computeViewDependentCurvaturesCPU(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals,
+	const std::vector<CurvatureVec4<T>>& PDs, const std::vector<T>& curvatures, const CurvatureVec3<T>& viewPosition,
+	std::vector<T>& q1s, std::vector<CurvatureVec2<T>>& t1s) {
+	typedef CurvatureVec3<T> Vec3;
+	const size_t vertexCount = vertices.size();
+	const T epsilon = T(1e-6);
+	q1s.resize(vertexCount);
+	t1s.resize(vertexCount);
+	globalThreadPool().parallelFor(0, vertexCount, 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const Vec3 normal = glm::normalize(Vec3(normals[i]));
+			const Vec3 maxPD = glm::normalize(Vec3(PDs[i]));
+			const Vec3 minPD = glm::normalize(Vec3(PDs[i + vertexCount]));
+			const T maxCurv = curvatures[i], minCurv = curvatures[i + vertexCount];
+			const Vec3 viewDir = glm::normalize(viewPosition - Vec3(vertices[i]));
+			T normalDotView = glm::dot(viewDir, normal);
+			//view direction in the PD basis
+			const T u = glm::dot(viewDir, maxPD), v = glm::dot(viewDir, minPD);
+			const T u2 = u * u, v2 = v * v, uv = u * v;
+			const T csc2 = T(1) / (u2 + v2);
+			//Q = S + (sec theta - 1) * S * w * w^T
+			if (std::abs(normalDotView) <= epsilon) normalDotView = epsilon;
+			const T secMinus1 = T(1) / std::abs(normalDotView) - T(1);
+			const T Q11 = maxCurv * (T(1) + secMinus1 * u2 * csc2);
+			const T Q12 = maxCurv * (secMinus1 * uv * csc2);
+			const T Q21 = minCurv * (secMinus1 * uv * csc2);
+			const T Q22 = minCurv * (T(1) + secMinus1 * v2 * csc2);
+			//largest singular value of Q from the eigenvalues of Q^TQ
+			const T QTQ1 = Q11 * Q11 + Q21 * Q21;
+			const T QTQ12 = Q11 * Q12 + Q21 * Q22;
+			const T QTQ2 = Q12 * Q12 + Q22 * Q22;
+			T q1 = T(0.5) * (QTQ1 + QTQ2);
+			const T root = std::sqrt(std::abs(QTQ12 * QTQ12 + T(0.25) * (QTQ2 - QTQ1) * (QTQ2 - QTQ1)));
+			q1 += (q1 > T(0)) ? root : -root;
+			q1s[i] = q1;
+			t1s[i] = glm::normalize(CurvatureVec2<T>(QTQ2 - q1, -QTQ12));
+		}
+	});
+}
+
+//Derivative of q1 along t1 per vertex, averaged over the opposite edges of its corners that the t1 line crosses.
+template<typename T>
+inline void computeDt1q1CPU(const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals, const std::vector<unsigned int>& indices,
+	const VertexCorners& corners, const std::vector<CurvatureVec4<T>>& PDs, const std::vector<T>& q1s, const std::vector<CurvatureVec2<T>>& t1s,
+	const CurvatureVec3<T>& viewPosition, std::vector<T>& Dt1q1s) {
+	typedef CurvatureVec3<T> Vec3;
+	const size_t vertexCount = vertices.size();
+	Dt1q1s.resize(vertexCount);
+	globalThreadPool().parallelFor(0, vertexCount, 1 << 14, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const Vec3 v0(vertices[i]);
+			const Vec3 normal = glm::normalize(Vec3(normals[i]));
+			const T normalDotView = glm::dot(glm::normalize(viewPosition - v0), normal);
+			const Vec3 maxPD = glm::normalize(Vec3(PDs[i]));
+			const Vec3 minPD = glm::normalize(Vec3(PDs[i + vertexCount]));
+			const T viewDepCurv = q1s[i];
+			const Vec3 t1 = t1s[i].x * maxPD + t1s[i].y * minPD;
+			const Vec3 t2 = glm::cross(normal, t1);
+			const T v0DotT2 = glm::dot(v0, t2);
+			int n = 0;
+			T Dt1q1 = T(0);
+			for (uint32_t k = corners.offsets[i]; k < corners.offsets[i + 1]; k++) {
+				const uint32_t corner = corners.corners[k];
+				const uint32_t face = corner - corner % 3;
+				const unsigned int v1 = indices[face + (corner + 1) % 3], v2 = indices[face + (corner + 2) % 3];
+				const Vec3 p1(vertices[v1]), p2(vertices[v2]);
+				//point of the opposite edge on the line through v0 along t1
+				const T v1DotT2 = glm::dot(p1, t2), v2DotT2 = glm::dot(p2, t2);
+				const T w1 = (v2DotT2 - v0DotT2) / (v2DotT2 - v1DotT2);
+				if (w1 < T(0) || w1 >= T(1)) continue;
+				const T w2 = T(1) - w1;
+				const Vec3 p = w1 * p1 + w2 * p2;
+				const T interpolated = w1 * q1s[v1] + w2 * q1s[v2];
+				const T projDistance = glm::dot(p - v0, t1) * std::abs(normalDotView);
+				Dt1q1 += (interpolated - viewDepCurv) / projDistance;
+				n++;
+			}
+			Dt1q1s[i] = Dt1q1 / T(n);
+		}
+	});
+}
+
+#endif
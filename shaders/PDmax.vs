@@ -15,9 +15,8 @@ out VS_OUT {
     vec3 minPrincipal;
 } vs_out;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform uint size;
+#pragma frameConstants //FrameConstants / DrawConstants blocks, inserted after #version by LoadShader.h
+layout(location = 0) uniform uint size;
 //uniform mat4 projection;
 
 void main()
@@ -7,9 +7,7 @@ in VS_OUT {
     vec3 minPrincipal;
 } gs_in[];
 
-uniform float magnitude;
-
-uniform mat4 projection;
+#pragma frameConstants //FrameConstants / DrawConstants blocks, inserted after #version by LoadShader.h
 
 void principalDirections(int index)
 {
@@ -17,14 +15,14 @@ void principalDirections(int index)
     /*
     gl_Position = projection * gl_in[index].gl_Position;
     EmitVertex();
-    gl_Position = projection * (gl_in[index].gl_Position + vec4(gs_in[index].maxPrincipal, 0.0) * magnitude);
+    gl_Position = projection * (gl_in[index].gl_Position + vec4(gs_in[index].maxPrincipal, 0.0) * PDMagnitude);
     EmitVertex();
     EndPrimitive();
     */
     //min principal dir
     gl_Position = projection * gl_in[index].gl_Position;
     EmitVertex();
-    gl_Position = projection * (gl_in[index].gl_Position + vec4(gs_in[index].minPrincipal, 0.0) * magnitude);
+    gl_Position = projection * (gl_in[index].gl_Position + vec4(gs_in[index].minPrincipal, 0.0) * PDMagnitude);
     EmitVertex();
     EndPrimitive();
 
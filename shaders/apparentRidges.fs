@@ -1,10 +1,9 @@
 #version 460
 out vec4 color;
 in float fade;
-uniform vec3 backgroundColor;
-uniform vec3 lineColor;
+#pragma frameConstants //FrameConstants / DrawConstants blocks, inserted after #version by LoadShader.h
 void main(){
     clamp(fade,0.0,1.0);
     //color = vec4(lineColor,1.0);
-    color = vec4(lineColor - (1.0-fade)*(lineColor-backgroundColor),1.0);
+    color = vec4(lineColor.rgb - (1.0-fade)*(lineColor.rgb-backgroundColor.rgb),1.0);
 }
\ No newline at end of file
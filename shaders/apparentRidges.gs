@@ -26,13 +26,7 @@ in VertexData{
 } geometryIn[]; //instance name can be different from vertex shader stage
 //gl_in[] for gl_PerVertex which carries gl_Position
 //geometryIn[] for the output we made
-uniform vec3 viewPosition;
-uniform float threshold;
-uniform bool drawFaded;
-uniform bool cull;
-uniform mat4 model;
-uniform mat4 projection;
-uniform mat4 view;
+#pragma frameConstants //FrameConstants / DrawConstants blocks, inserted after #version by LoadShader.h
 
 const float epsilon = 1e-6;
 
@@ -101,11 +95,12 @@ void drawApparentRidgeSegment(const int v0,const int v1,const int v2,
     //Draw line segment
     //gl_Position = vec4(p01,1.0);
     bool firstEmitted=false;
-    gl_Position = projection * view *vec4(p01,1.0);
+    //segment ends are in object space
+    gl_Position = projection * view * model * vec4(p01,1.0);
     fade = k01;
     EmitVertex();
     //gl_Position = vec4(p12,1.0);
-    gl_Position = projection * view *vec4(p12,1.0);
+    gl_Position = projection * view * model * vec4(p12,1.0);
     fade = k12;
     EmitVertex();
     EndPrimitive();
@@ -13,9 +13,6 @@ layout(binding = 7, std430) readonly buffer PDBuffer
 layout(binding = 8, std430) readonly buffer curvatureBufffer{
     float curvatures[];
 };
-layout(binding = 20, std430) readonly buffer adjacentFacesBuffer{
-    int adjFaces[][20];
-};
 layout(binding = 21, std430) buffer q1Buffer{
     float q1s[];
 };
@@ -41,22 +38,15 @@ out VertexData{
     uint id;
 } vertexOut;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-uniform vec3 viewPosition;
-
-uniform float threshold;
+#pragma frameConstants //FrameConstants / DrawConstants blocks, inserted after #version by LoadShader.h
 void main() {
     gl_Position = projection * view *  model * vec4(inPosition, 1.0);
 
-    vec3 position = vec3(model * vec4(inPosition, 1.0)); 
-    //position = vec3(projection * view *  model * vec4(inPosition, 1.0));
-    vec3 normal = mat3(transpose(inverse(model))) * inNormal;
-    
-    //I think Assimp normalizes the normals anyway.
-    vec3 viewDir = normalize(viewPosition - position);
+    //everything below stays in object space like the compute passes,
+    //the model matrix is only applied for the projection (here and in apparentRidges.gs)
+    vec3 position = inPosition;
+    vec3 normal = normalize(inNormal);
+    vec3 viewDir = normalize(objectViewPosition.xyz - position);
     
     float ndotv = dot(viewDir,normal);
     
@@ -66,8 +56,8 @@ void main() {
     vertexOut.normalDotView = ndotv;
     vertexOut.viewDirection = viewDir;
 
-    vertexOut.maxPrincpal = normalize(vec3(model * maxPD));
-    vertexOut.minPrincipal = normalize(vec3(model * minPD));
+    vertexOut.maxPrincpal = normalize(maxPD.xyz);
+    vertexOut.minPrincipal = normalize(minPD.xyz);
     vertexOut.maxCurvature = maxCurv;
     vertexOut.minCurvature = minCurv;
 
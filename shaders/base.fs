@@ -4,7 +4,7 @@ in vec3 FragPos;
 in vec2 TexCoords;
 out vec4 color;
 
-uniform vec3 backgroundColor;
+#pragma frameConstants //FrameConstants / DrawConstants blocks, inserted after #version by LoadShader.h
 void main() {
-    color = vec4(backgroundColor,1.0);
+    color = vec4(backgroundColor.rgb,1.0);
 }
\ No newline at end of file
@@ -1,27 +1,21 @@
 #version 430
 
-struct Light {
-    vec3 position;
-    vec3 diffuse;
-};
-
 in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
 
 out vec4 color;
 
-uniform vec3 viewPos;
-uniform Light light;
+#pragma frameConstants //FrameConstants / DrawConstants blocks, inserted after #version by LoadShader.h
 void main() {
     // diffuse
     float ambient = 0.05;
     vec3 norm = normalize(Normal);
-    vec3 lightDir = normalize(light.position - FragPos);
+    vec3 lightDir = normalize(lightPosition.xyz - FragPos);
     float diff = max(dot(norm, lightDir), 0.0); //cos
     //vec3 diffuse = light.diffuse * diff * high;
      // specular
-    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 viewDir = normalize(viewPosition.xyz - FragPos);
     vec3 reflectDir = reflect(-lightDir, norm);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
     vec3 specular;
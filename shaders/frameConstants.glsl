@@ -0,0 +1,18 @@
+//Per frame and per draw constants (FrameUniforms.h), the one declaration of the blocks : LoadShader.h inserts them
+//after the #version line of every shader with a "#pragma frameConstants" line. Must match the C++ structs.
+layout(std140, binding = 0) uniform FrameConstants{
+    mat4 view;
+    mat4 projection;
+    vec4 viewPosition; //world space
+    vec4 lightPosition;
+    vec4 lineColor;
+    vec4 backgroundColor;
+    bool drawFaded;
+    bool cull;
+};
+layout(std140, binding = 1) uniform DrawConstants{
+    mat4 model;
+    vec4 objectViewPosition; //the model's object space
+    float threshold;
+    float PDMagnitude;
+};
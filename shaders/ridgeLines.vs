@@ -0,0 +1,12 @@
+#version 460
+//Draws the segments apparentRidges.compute appended, two vertices per line, no vertex attributes.
+layout(binding = 24, std430) readonly buffer ridgeSegmentBuffer{
+    vec4 ridgeSegments[]; //xyz : object space position, w : fade
+};
+#pragma frameConstants //FrameConstants / DrawConstants blocks, inserted after #version by LoadShader.h
+out float fade;
+void main() {
+    vec4 segmentVertex = ridgeSegments[gl_VertexID];
+    gl_Position = projection * view * model * vec4(segmentVertex.xyz, 1.0);
+    fade = segmentVertex.w;
+}